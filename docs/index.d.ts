@@ -62,11 +62,19 @@ export interface WebSocket<UserData> {
      */
     send(message: RecognizedString, isBinary?: boolean, compress?: boolean) : number;
 
+    /** Sends every message of messages, framed natively into one cork buffer in one call.
+     * Stops at the first message dropped due to backpressure limit. Returns 2 if any was dropped, else 0 if any built up backpressure, else 1. See send.
+     */
+    sendMany(messages: RecognizedString[], isBinary?: boolean, compress?: boolean) : number;
+
     /** Returns the bytes buffered in backpressure. This is similar to the bufferedAmount property in the browser counterpart.
      * Check backpressure example.
      */
     getBufferedAmount() : number;
 
+    /** Returns the smoothed round trip time in milliseconds of a WebSocket whose behavior has measureRtt, or 0 until it is measured. */
+    getRtt() : number;
+
     /** Gracefully closes this WebSocket. Immediately calls the close handler.
      * A WebSocket close message is sent with code and shortMessage.
      */
@@ -80,7 +88,10 @@ export interface WebSocket<UserData> {
     /** Sends a ping control message. Returns sendStatus similar to WebSocket.send (regarding backpressure). This helper function correlates to WebSocket::send(message, uWS::OpCode::PING, ...) in C++. */
     ping(message?: RecognizedString) : number;
 
-    /** Subscribe to a topic. */
+    /** Subscribe to a topic. Topics with a level of + (matching any one level) or a last level of # (matching any number of levels)
+     * are MQTT style wildcard patterns, receiving messages published under every matching topic, such as "sensors/+/temperature" or "sensors/#".
+     * Publishing under a pattern only reaches subscribers of that same literal topic, wildcard patterns do not count towards numSubscribers
+     * and do not call the subscription handler. */
     subscribe(topic: RecognizedString) : boolean;
 
     /** Unsubscribe from a topic. Returns true on success, if the WebSocket was subscribed. */
@@ -89,13 +100,24 @@ export interface WebSocket<UserData> {
     /** Returns whether this websocket is subscribed to topic. */
     isSubscribed(topic: RecognizedString) : boolean;
 
-    /** Returns a list of topics this websocket is subscribed to. */
+    /** Returns a list of topics this websocket is subscribed to, followed by its wildcard patterns. */
     getTopics() : string[];
 
+    /** Returns the number of topics and wildcard patterns this websocket is subscribed to, without listing them. */
+    topicCount() : number;
+
+    /** Sets a native timer calling cb with this WebSocket after ms milliseconds, or every ms milliseconds if repeat.
+     * The timer is cleared automatically when the WebSocket closes. Pass the same cb for all sockets to allocate nothing per timer.
+     * Returns a timer handle which may be cleared early with uWS.clearTimeout. */
+    setTimer(ms: number, cb: (ws: WebSocket<UserData>) => void, repeat?: boolean) : number;
+
     /** Publish a message under topic. Backpressure is managed according to maxBackpressure, closeOnBackpressureLimit settings.
      * Order is guaranteed since v20.
+     *
+     * If conflate, subscribers over their conflationWatermark only get the latest message published under topic once they drain,
+     * rather than buffering every message. Suits topics where only the newest value matters, such as price tickers.
     */
-    publish(topic: RecognizedString, message: RecognizedString, isBinary?: boolean, compress?: boolean) : boolean;
+    publish(topic: RecognizedString, message: RecognizedString, isBinary?: boolean, compress?: boolean, conflate?: boolean) : boolean;
 
     /** See HttpResponse.cork. Takes a function in which the socket is corked (packing many sends into one single syscall/SSL block) */
     cork(cb: () => void) : WebSocket<UserData>;
@@ -118,6 +140,12 @@ export interface WebSocket<UserData> {
     /** Returns the UserData object. */
     getUserData() : UserData;
 
+    /** Returns the native field of index as declared by slots of the behavior. Byte fields are returned as a copy. */
+    getSlot(index: number) : number | ArrayBuffer;
+
+    /** Sets the native field of index as declared by slots of the behavior. Byte fields take at most their capacity. */
+    setSlot(index: number, value: number | RecognizedString) : WebSocket<UserData>;
+
     /** Sends the first fragment of a fragmented message. Use for sending large messages in chunks.
      * Returns 1 for success, 2 for dropped due to backpressure limit, and 0 for built up backpressure.
      */
@@ -132,6 +160,23 @@ export interface WebSocket<UserData> {
      * Returns 1 for success, 2 for dropped due to backpressure limit, and 0 for built up backpressure.
      */
     sendLastFragment(message: RecognizedString, compress?: boolean) : number;
+
+    /** Sends one large message from source as fragments of fragmentSize (default 64kb), natively. Sending pauses while more than watermark
+     * (default fragmentSize) bytes are buffered and resumes on drain, so memory stays at about one fragment no matter the size of the message.
+     *
+     * Source is an ArrayBuffer or ArrayBufferView, a file descriptor read from its current size (left open), or a function called with the max
+     * length of the chunk to return, where null, undefined or an empty chunk ends the message. isBinary defaults to true.
+     *
+     * No other message may go out between the fragments of one message. So until the stream ends, send, sendMany, uWS.sendTo and publishes
+     * to this WebSocket are queued and sent after the last fragment. They return 0 (backpressure) when queued, or 2 (dropped) past maxBackpressure
+     * queued bytes. Conflated publishes are deferred as for slow subscribers. sendFirstFragment, sendFragment and sendLastFragment return 2.
+     * The exact topics of this WebSocket are taken from the topic tree meanwhile, so numSubscribers and the subscription handler see it
+     * leave them and come back, while isSubscribed and getTopics keep listing them. Must not be called between sendFirstFragment and sendLastFragment.
+     *
+     * Calls cb with whether the whole message was sent, after the queued messages went out, also if the WebSocket closed before.
+     * A source failing after the first fragment closes the WebSocket. Returns false if a stream is already being sent on this WebSocket.
+     */
+    sendStream(source: RecognizedString | number | ((maxLength: number) => RecognizedString | null | undefined), options?: {fragmentSize?: number, watermark?: number, isBinary?: boolean, compress?: boolean}, cb?: (completed: boolean) => void) : boolean;
 }
 
 /** An HttpResponse is valid until either onAborted callback or any of the .end/.tryEnd calls succeed. You may attach user data to this object. */
@@ -166,6 +211,14 @@ export interface HttpResponse {
     /** Ends this response, or tries to, by streaming appropriately sized chunks of body. Use in conjunction with onWritable. Returns tuple [ok, hasResponded].*/
     tryEnd(fullBodyOrChunk: RecognizedString, totalSize: number) : [boolean, boolean];
 
+    /** Sends length bytes of a file from offset as the body, natively and without calling into JavaScript per chunk, resuming as the socket drains.
+     * The file is given as a path or a file descriptor, which is duplicated and may be closed right after. totalSize is the size of the whole body and
+     * defaults to the bytes written so far plus length. cb is called once, with true when the file was sent and false if aborted or if the file could
+     * not be read, possibly before sendFile returns. This takes over onWritable and onAborted. If the body goes on past the file, res is left open
+     * after cb for writing the rest, with onAborted to be attached again. Throws if offset, length or totalSize is negative or not a number, or if
+     * offset plus length goes past the end of the file. */
+    sendFile(fdOrPath: number | RecognizedString, offset: number, length: number, totalSize?: number, cb?: (sent: boolean) => void) : HttpResponse;
+
     /** Immediately force closes the connection. Any onAborted callback will run. */
     close() : HttpResponse;
 
@@ -188,6 +241,12 @@ export interface HttpResponse {
      * Must be attached before performing any asynchronous operation, otherwise data may be lost.
      * You MUST copy the data of chunk if isLast is not true. We Neuter ArrayBuffers on return, making them zero length. */
     onData(handler: (chunk: ArrayBuffer, isLast: boolean) => void) : HttpResponse;
+
+    /** Sets a native timer calling cb with this HttpResponse after ms milliseconds, or every ms milliseconds if repeat.
+     * The timer is cleared automatically when the response is ended, upgraded, closed or aborted.
+     * Throws unless onAborted (or sendFile) was called first, since aborts are only seen through it.
+     * Returns a timer handle which may be cleared early with uWS.clearTimeout. */
+    setTimer(ms: number, cb: (res: HttpResponse) => void, repeat?: boolean) : number;
     
     /** Pause HTTP request body streaming (throttle).
      * Some buffered data may still be sent to onData. */
@@ -289,18 +348,50 @@ export interface WebSocketBehavior<UserData> {
     compression?: CompressOptions;
     /** Maximum length of allowed backpressure per socket when publishing or sending messages. Slow receivers with too high backpressure will be skipped until they catch up or timeout. Defaults to 64 * 1024. */
     maxBackpressure?: number;
+    /** Conflated publishes to a WebSocket buffering more than this many bytes are deferred, keeping only the latest message per topic until drain. Defaults to 0, deferring whenever anything is buffered. */
+    conflationWatermark?: number;
+    /** Compression size cap. ws.send, ws.sendMany, ws.publish and uWS.sendTo messages longer than this many bytes go out uncompressed even if asking for compress.
+     * This only skips deflating them on the loop thread, nothing is offloaded to other threads. TemplatedApp.publish and inflating received messages are not affected.
+     * 0 disables. Defaults to 0. */
+    maxCompressLength?: number;
+    /** How text messages are given to message (and rateLimited): 'arraybuffer', 'string' made natively from the frame, or 'json' parsed natively from it, skipping the ArrayBuffer.
+     * Text messages failing to parse as JSON are given as string to parseError, or to message without it. Binary messages are always given as ArrayBuffer. Defaults to 'arraybuffer'. */
+    messageFormat?: 'arraybuffer' | 'string' | 'json';
+    /** Native per WebSocket fields, by index: 'int32', 'float64' or a number being the capacity in bytes of a byte field. They live in one native block
+     * per WebSocket of at most 65536 bytes, outside of the JS heap and its garbage collection, and are read and written with getSlot and setSlot.
+     * All start out as zero or empty. Byte capacities must be integers. */
+    slots?: ('int32' | 'float64' | number)[];
+    /** Whether WebSocket objects are only kept alive while referenced from JS, so that idle WebSockets cost no JS object. Requires slots.
+     * One collected is made again for the next event, without the properties set on it (including those of the userData given to upgrade),
+     * so getUserData then no longer returns them. Keep such state in slots. Defaults to false. */
+    weakObjects?: boolean;
+    /** Whether to measure round trip time natively, for ws.getRtt and app.rttStats. A timestamped ping is sent on open and after pongs to automatic pings,
+     * at most once a second, so together with sendPingsAutomatically it is measured about once per idleTimeout. Only the pong echoing the latest of these
+     * pings is a sample, others are ignored. Pongs carrying these pings are not given to pong. Defaults to false. */
+    measureRtt?: boolean;
     /** Whether or not we should automatically send pings to uphold a stable connection given whatever idleTimeout. */
     sendPingsAutomatically?: boolean;
+    /** Maximum number of messages per second each WebSocket may send, with bursts of up to one second worth. Messages over the limit are dropped natively, before calling message. 0 disables. Defaults to 0. */
+    maxMessagesPerSecond?: number;
+    /** Maximum number of message bytes per second each WebSocket may send. A message may exceed what is left for the current second, blocking further messages until the debt is paid off. 0 disables. Defaults to 0. */
+    maxBytesPerSecond?: number;
+    /** Whether or not we should close the socket with code 1008 when it exceeds maxMessagesPerSecond or maxBytesPerSecond. Defaults to false. */
+    closeOnRateLimit?: boolean;
     /** Upgrade handler used to intercept HTTP upgrade requests and potentially upgrade to WebSocket.
      * See UpgradeAsync and UpgradeSync example files.
      */
     upgrade?: (res: HttpResponse, req: HttpRequest, context: us_socket_context_t) => void | Promise<void>;
     /** Handler for new WebSocket connection. WebSocket is valid from open to close, no errors. */
     open?: (ws: WebSocket<UserData>) => void | Promise<void>;
-    /** Handler for a WebSocket message. Messages are given as ArrayBuffer no matter if they are binary or not. Given ArrayBuffer is valid during the lifetime of this callback (until first await or return) and will be neutered. */
-    message?: (ws: WebSocket<UserData>, message: ArrayBuffer, isBinary: boolean) => void | Promise<void>;
+    /** Handler for a WebSocket message. Messages are given as ArrayBuffer no matter if they are binary or not, unless messageFormat says otherwise for text messages. Given ArrayBuffer is valid during the lifetime of this callback (until first await or return) and will be neutered. */
+    message?: (ws: WebSocket<UserData>, message: ArrayBuffer | string | any, isBinary: boolean) => void | Promise<void>;
     /** Handler for a dropped WebSocket message. Messages can be dropped due to specified backpressure settings. Messages are given as ArrayBuffer no matter if they are binary or not. Given ArrayBuffer is valid during the lifetime of this callback (until first await or return) and will be neutered. */
     dropped?: (ws: WebSocket<UserData>, message: ArrayBuffer, isBinary: boolean) => void | Promise<void>;
+    /** Handler for a message over maxMessagesPerSecond or maxBytesPerSecond, called instead of message. Without this handler such messages never enter JavaScript. Given ArrayBuffer is valid during the lifetime of this callback (until first await or return) and will be neutered. */
+    rateLimited?: (ws: WebSocket<UserData>, message: ArrayBuffer, isBinary: boolean) => void;
+    /** Handler for a text message failing to parse as JSON with messageFormat 'json', called instead of message with the text and the exception of the parse.
+     * Without this handler such messages are given to message as string. */
+    parseError?: (ws: WebSocket<UserData>, message: string, error: any) => void;
     /** Handler for when WebSocket backpressure drains. Check ws.getBufferedAmount(). Use this to guide / drive your backpressure throttling. */
     drain?: (ws: WebSocket<UserData>) => void;
     /** Handler for close event, no matter if error, timeout or graceful close. You may not use WebSocket after this event. Do not send on this WebSocket from within here, it is closed. */
@@ -313,6 +404,31 @@ export interface WebSocketBehavior<UserData> {
     subscription?: (ws: WebSocket<UserData>, topic: ArrayBuffer, newCount: number, oldCount: number) => void;
 }
 
+/** Slow consumer counters of a WebSocket behavior, kept natively since it was added with app.ws. */
+export interface WebSocketStats {
+    /** Messages dropped for going over maxBackpressure, and their bytes. Counted whether or not there is a dropped handler. */
+    droppedMessages: number;
+    droppedBytes: number;
+    /** WebSockets closed for going over maxBackpressure with closeOnBackpressureLimit. */
+    backpressureCloses: number;
+    /** Times backpressure drained. */
+    drains: number;
+    /** Largest buffered amount seen on drain, drop and close. */
+    maxBufferedAmount: number;
+}
+
+/** Round trip times in milliseconds, accurate to within 1/16. */
+export interface RttStats {
+    count: number;
+    min: number;
+    mean: number;
+    p50: number;
+    p90: number;
+    p99: number;
+    p999: number;
+    max: number;
+}
+
 /** Options used when constructing an app. Especially for SSLApp.
  * These are options passed directly to uSockets, C layer.
  */
@@ -325,6 +441,44 @@ export interface AppOptions {
     ssl_ciphers?: RecognizedString;
     /** This translates to SSL_MODE_RELEASE_BUFFERS */
     ssl_prefer_low_memory_usage?: boolean;
+    /** Maximum number of HTTP requests per second from each client address, counted over a sliding window in a fixed size table.
+     * Requests over the limit are answered with 429 Too Many Requests before any route handler or upgrade handler is called.
+     * This covers every route, including cached and declarative get routes, static, assets and WebSocket routes with or without an upgrade handler. A request handed on with setYield counts once. 0 disables. Defaults to 0. */
+    maxRequestsPerSecond?: number;
+    /** Whether maxRequestsPerSecond counts by the address given by the PROXY protocol instead of the peer address. Defaults to false. */
+    rateLimitProxiedAddress?: boolean;
+    /** Whether to count publishes and bytes published by topic, for topicStats. Defaults to false. */
+    topicStats?: boolean;
+}
+
+/** Options of app.static. */
+export interface StaticOptions {
+    /** File served for paths ending in /, or '' for none. Defaults to 'index.html'. */
+    index?: RecognizedString;
+    /** Cache-Control header of every response, none if not given. */
+    cacheControl?: RecognizedString;
+    /** Maximum number of file descriptors kept open between requests. Defaults to 256. */
+    maxOpenFiles?: number;
+}
+
+/** Options of app.assets, applying to all assets of the app. */
+export interface AssetOptions {
+    /** Asset served for URLs ending in /, or '' for none. Defaults to 'index.html'. */
+    index?: RecognizedString;
+    /** Cache-Control header of assets added from now on, none if not given. */
+    cacheControl?: RecognizedString;
+    /** Files larger than this are skipped when loading a directory, leaving them to app.static. Defaults to 1 MiB. */
+    maxFileSize?: number;
+}
+
+/** Options of app.setAsset. */
+export interface SetAssetOptions {
+    /** Content-Type of the asset. Defaults to one by the extension of the URL. */
+    contentType?: RecognizedString;
+    /** The asset compressed with gzip. Made natively if not given. */
+    gzip?: RecognizedString;
+    /** The asset compressed with brotli, for example by zlib.brotliCompressSync. None if not given. */
+    br?: RecognizedString;
 }
 
 export enum ListenOptions {
@@ -364,12 +518,35 @@ export interface TemplatedApp {
     trace(pattern: RecognizedString, handler: (res: HttpResponse, req: HttpRequest) => void | Promise<void>) : TemplatedApp;
     /** Registers an HTTP handler matching specified URL pattern on any HTTP method. */
     any(pattern: RecognizedString, handler: (res: HttpResponse, req: HttpRequest) => void | Promise<void>) : TemplatedApp;
+    /** Serves GET and HEAD requests under prefix with the files below directory, natively and without calling into JavaScript.
+     * Open files are cached and checked for changes at most once a second. Responses carry ETag and Last-Modified, answering If-None-Match and
+     * If-Modified-Since with 304, and single byte ranges of Range requests with 206. Bodies are read in chunks and sent as the socket drains. */
+    static(prefix: RecognizedString, directory: RecognizedString, options?: StaticOptions) : TemplatedApp;
+    /** Serves GET and HEAD requests under prefix from memory, loading every file below directory if given, with .gz and .br siblings as precompressed codings.
+     * Every asset is held with its identity, gzip and brotli codings as ready responses, picked natively by Accept-Encoding. Requests of URLs without an
+     * asset yield to the routes added after, so app.static or a handler may follow under the same prefix. */
+    assets(prefix: RecognizedString, directory?: RecognizedString, options?: AssetOptions) : TemplatedApp;
+    /** Adds or replaces the asset of url, serving it even outside of any prefix given to assets. */
+    setAsset(url: RecognizedString, data: RecognizedString, options?: SetAssetOptions) : TemplatedApp;
+    /** Removes the asset of url, returns whether there was one. */
+    removeAsset(url: RecognizedString) : boolean;
     /** Registers a handler matching specified URL pattern where WebSocket upgrade requests are caught. */
     ws<UserData>(pattern: RecognizedString, behavior: WebSocketBehavior<UserData>) : TemplatedApp;
     /** Publishes a message under topic, for all WebSockets under this app. See WebSocket.publish. */
-    publish(topic: RecognizedString, message: RecognizedString, isBinary?: boolean, compress?: boolean) : boolean;
+    publish(topic: RecognizedString, message: RecognizedString, isBinary?: boolean, compress?: boolean, conflate?: boolean) : boolean;
+    /** Publishes messages[i] under topics[i], or one message under all topics, in one call. Returns the number of successful publishes. See publish. */
+    publishBatch(topics: RecognizedString[], messages: RecognizedString[] | RecognizedString, isBinary?: boolean, compress?: boolean) : number;
     /** Returns number of subscribers for this topic. */
     numSubscribers(topic: RecognizedString) : number;
+    /** Returns the number of subscribers of every topic, in order. */
+    numSubscribersMany(topics: RecognizedString[]) : Int32Array;
+    /** Calls cb with every topic published to since the last call, its number of subscribers, and the number of publishes and bytes published since the last call.
+     * Requires the topicStats app option. Publish rates are these counts divided by the time between calls. */
+    topicStats(cb: (topic: string, subscribers: number, publishes: number, bytes: number) => void) : TemplatedApp;
+    /** Returns the slow consumer counters of the WebSocket behavior added under pattern, or undefined if there is none. Cheap enough to poll. */
+    wsStats(pattern: RecognizedString) : WebSocketStats | undefined;
+    /** Returns round trip time percentiles in milliseconds, of all WebSockets of behaviors with measureRtt since the last call. Undefined if there are none. */
+    rttStats() : RttStats | undefined;
     /** Adds a server name. */
     addServerName(hostname: string, options: AppOptions) : TemplatedApp;
     /** Browse to SNI domain. Used together with .get, .post and similar to attach routes under SNI domains. */
@@ -414,6 +591,46 @@ export interface MultipartField {
 /** Takes a POSTed body and contentType, and returns an array of parts if the request is a multipart request */
 export function getParts(body: RecognizedString, contentType: RecognizedString) : MultipartField[] | undefined;
 
+/** Publishes a message under topic for all apps of all threads (WorkerThreads) that have created an app.
+ * Apps of the calling thread get it immediately, apps of other threads as soon as their event loop wakes up.
+ * The message is copied once and shared by all threads, in place of posting it to each worker and republishing there. */
+export function publish(topic: RecognizedString, message: RecognizedString, isBinary?: boolean, compress?: boolean) : void;
+
+/** Sends one message to every WebSocket of webSockets in a single native loop, converting the message only once.
+ * For audiences not mapping well onto topics. Returns the sendStatus of every WebSocket, in order, where closed WebSockets count as dropped (2). See WebSocket.send. */
+export function sendTo(webSockets: WebSocket<any>[], message: RecognizedString, isBinary?: boolean, compress?: boolean) : Uint8Array;
+
+/** Watches the shared key-value store of all threads for changes to keys of collection starting with prefix (use "" for all keys).
+ * Changes made by any thread are batched and handed to cb on the event loop of the watching thread, as one array of changed keys per wake-up,
+ * each key at most once. A deleted collection shows up as null. Returns a watcher id for unwatch. */
+export function watch(collection: RecognizedString, prefix: RecognizedString, cb: (keys: (string | null)[]) => void) : number;
+
+/** Stops a watcher returned by watch. Must be called on the thread that called watch. Unknown ids are ignored. */
+export function unwatch(watcher: number) : void;
+
+/** Sets a native timer calling cb once after ms milliseconds, with 10ms resolution. Returns an integer handle below 2^53.
+ * Much cheaper than Node.js setTimeout when you have very many timers, such as one per connection.
+ * Pass null as cb to have the timer delivered to the onExpired handler instead.
+ * Never fires before ms have passed. Clearing a timer that has triggered or been cleared does nothing, also later on.
+ * Throws unless ms is a number from 0 to 4294967295. */
+export function setTimeout(cb: (() => void) | null, ms: number) : number;
+
+/** Sets a native timer calling cb every ms milliseconds until cleared, every tick for 0ms. See setTimeout. */
+export function setInterval(cb: (() => void) | null, ms: number) : number;
+
+/** Clears a timer set with uWS.setTimeout or uWS.setInterval. May be called from within any timer callback. */
+export function clearTimeout(timer: number) : void;
+
+/** Same as clearTimeout. */
+export function clearInterval(timer: number) : void;
+
+/** Registers the handler receiving all timers set without callback that expire in the same tick, as one array of handles.
+ * Thousands of simultaneous timeouts then cost one call into JavaScript. Pass null to unregister. */
+export function onExpired(handler: ((timers: Float64Array) => void) | null) : void;
+
+/** Sets how often, in milliseconds (multiples of 10), the native timers are driven. Defaults to 10. */
+export function arm(ms: number) : void;
+
 /** WebSocket compression options. Combine any compressor with any decompressor using bitwise OR. */
 export type CompressOptions = number;
 /** No compression (always a good idea if you operate using an efficient binary protocol) */
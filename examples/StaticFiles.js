@@ -0,0 +1,19 @@
+/* Serves the files of a directory natively, with caching validators and Range requests.
+ * Try seeking in a video served from here; no JavaScript runs per request or chunk. */
+
+const uWS = require('../dist/uws.js');
+const port = 9001;
+
+const app = uWS./*SSL*/App({
+  key_file_name: 'misc/key.pem',
+  cert_file_name: 'misc/cert.pem',
+  passphrase: '1234'
+}).static('/', __dirname, {
+  cacheControl: 'public, max-age=60'
+}).listen(port, (token) => {
+  if (token) {
+    console.log('Listening to port ' + port);
+  } else {
+    console.log('Failed to listen to port ' + port);
+  }
+});
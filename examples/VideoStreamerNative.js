@@ -0,0 +1,39 @@
+/* This is an example of native streaming of large files.
+ * Unlike VideoStreamer.js no JavaScript runs per chunk;
+ * backpressure is handled natively until the file is sent.
+ * Try navigating to the adderss with Chrome and see the video
+ * in real time. */
+
+const uWS = require('../dist/uws.js');
+const fs = require('fs');
+
+const port = 9001;
+const fileName = 'spritefright.mp4';
+const totalSize = fs.statSync(fileName).size;
+
+let openStreams = 0;
+
+console.log('Video size is: ' + totalSize + ' bytes');
+
+/* Yes, you can easily swap to SSL streaming by uncommenting here */
+const app = uWS./*SSL*/App({
+  key_file_name: 'misc/key.pem',
+  cert_file_name: 'misc/cert.pem',
+  passphrase: '1234'
+}).get('/spritefright.mp4', (res, req) => {
+  console.log('Stream was opened, openStreams: ' + ++openStreams);
+
+  /* Called once, whether sent or aborted */
+  res.writeHeader('Content-Type', 'video/mp4').sendFile(fileName, 0, totalSize, totalSize, (sent) => {
+    console.log('Stream was ' + (sent ? 'sent' : 'aborted') + ', openStreams: ' + --openStreams);
+  });
+}).get('/*', (res, req) => {
+  /* Make sure to always handle every route */
+  res.end('Nothing to see here!');
+}).listen(port, (token) => {
+  if (token) {
+    console.log('Listening to port ' + port);
+  } else {
+    console.log('Failed to listen to port ' + port);
+  }
+});
@@ -18,8 +18,44 @@
 #include "App.h"
 #include <v8.h>
 #include "Utilities.h"
+#include "LoopQueue.h"
+#include "WildcardTopics.h"
+#include "ConflatedTopics.h"
+#include "SendStream.h"
+#include "TopicStats.h"
+#include "StaticFiles.h"
+#include "AssetCache.h"
+
+#include <memory>
+#include <mutex>
 using namespace v8;
 
+/* Holds the JS object of a WebSocket. Behaviors with slots opting in to weakObjects keep per socket state natively
+ * and hold it weakly, so that idle sockets cost no JS object */
+static inline void holdWsObject(Isolate *isolate, PerSocketData *perSocketData, Local<Object> wsObject) {
+    perSocketData->socketPf.Reset(isolate, wsObject);
+    if (perSocketData->slotSchema && perSocketData->slotSchema->weakObjects) {
+        perSocketData->socketPf.SetWeak(perSocketData, [](const WeakCallbackInfo<PerSocketData> &data) {
+            data.GetParameter()->socketPf.Reset();
+        }, WeakCallbackType::kParameter);
+    }
+}
+
+/* Returns the JS object of ws, made again if it was collected */
+template <typename APP, class WEBSOCKET>
+static inline Local<Object> getWsObject(PerContextData *perContextData, WEBSOCKET *ws) {
+    Isolate *isolate = perContextData->isolate;
+    PerSocketData *perSocketData = (PerSocketData *) ws->getUserData();
+    if (!perSocketData->socketPf.IsEmpty()) {
+        return Local<Object>::New(isolate, perSocketData->socketPf);
+    }
+
+    Local<Object> wsObject = perContextData->wsTemplate[getAppTypeIndex<APP>()].Get(isolate)->Clone();
+    setInternalPointer(wsObject, ws);
+    holdWsObject(isolate, perSocketData, wsObject);
+    return wsObject;
+}
+
 /* uWS.App.ws('/pattern', behavior) */
 template <typename APP>
 void uWS_App_ws(const FunctionCallbackInfo<Value> &args) {
@@ -51,6 +87,15 @@ void uWS_App_ws(const FunctionCallbackInfo<Value> &args) {
     UniquePersistent<Function> pingPf;
     UniquePersistent<Function> pongPf;
     UniquePersistent<Function> subscriptionPf;
+    UniquePersistent<Function> rateLimitedPf;
+    UniquePersistent<Function> parseErrorPf;
+
+    RateLimit rateLimit;
+    uint32_t conflationWatermark = 0;
+    uint32_t maxCompressLength = 0;
+    MessageFormat messageFormat = MessageFormat::ARRAYBUFFER;
+    std::shared_ptr<SlotSchema> slotSchema;
+    std::shared_ptr<LatencyHistogram> rttHistogram;
 
     /* Get the behavior object */
     if (args.Length() == 2) {
@@ -99,6 +144,111 @@ void uWS_App_ws(const FunctionCallbackInfo<Value> &args) {
             behavior.maxBackpressure = maybeMaxBackpressure.ToLocalChecked()->Int32Value(isolate->GetCurrentContext()).ToChecked();
         }
 
+        /* conflationWatermark or default */
+        MaybeLocal<Value> maybeConflationWatermark = behaviorObject->Get(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "conflationWatermark", NewStringType::kNormal).ToLocalChecked());
+        if (!maybeConflationWatermark.IsEmpty() && !maybeConflationWatermark.ToLocalChecked()->IsUndefined()) {
+            conflationWatermark = maybeConflationWatermark.ToLocalChecked()->Uint32Value(isolate->GetCurrentContext()).ToChecked();
+        }
+
+        /* maxCompressLength or unlimited */
+        MaybeLocal<Value> maybeMaxCompressLength = behaviorObject->Get(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "maxCompressLength", NewStringType::kNormal).ToLocalChecked());
+        if (!maybeMaxCompressLength.IsEmpty() && !maybeMaxCompressLength.ToLocalChecked()->IsUndefined()) {
+            maxCompressLength = maybeMaxCompressLength.ToLocalChecked()->Uint32Value(isolate->GetCurrentContext()).ToChecked();
+        }
+
+        /* messageFormat or default */
+        MaybeLocal<Value> maybeMessageFormat = behaviorObject->Get(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "messageFormat", NewStringType::kNormal).ToLocalChecked());
+        if (!maybeMessageFormat.IsEmpty() && !maybeMessageFormat.ToLocalChecked()->IsUndefined()) {
+            NativeString messageFormatString(isolate, maybeMessageFormat.ToLocalChecked());
+            if (messageFormatString.isInvalid(args)) {
+                return;
+            }
+            if (messageFormatString.getString() == "string") {
+                messageFormat = MessageFormat::STRING;
+            } else if (messageFormatString.getString() == "json") {
+                messageFormat = MessageFormat::JSON;
+            } else if (messageFormatString.getString() != "arraybuffer") {
+                args.GetReturnValue().Set(isolate->ThrowException(v8::Exception::Error(String::NewFromUtf8(isolate, "messageFormat must be 'arraybuffer', 'string' or 'json'.", NewStringType::kNormal).ToLocalChecked())));
+                return;
+            }
+        }
+
+        /* slots or none, an array of 'int32', 'float64' or byte capacity */
+        MaybeLocal<Value> maybeSlots = behaviorObject->Get(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "slots", NewStringType::kNormal).ToLocalChecked());
+        if (!maybeSlots.IsEmpty() && maybeSlots.ToLocalChecked()->IsArray()) {
+            Local<Array> slots = Local<Array>::Cast(maybeSlots.ToLocalChecked());
+            slotSchema = std::make_shared<SlotSchema>();
+            for (uint32_t i = 0; i < slots->Length(); i++) {
+                Local<Value> slot = slots->Get(isolate->GetCurrentContext(), i).ToLocalChecked();
+                bool added;
+                if (slot->IsNumber()) {
+                    /* Checked before narrowing, so that nothing wraps or truncates into a valid capacity */
+                    double capacity = Local<Number>::Cast(slot)->Value();
+                    if (!(capacity >= 0 && capacity <= SlotSchema::MAX_SIZE) || capacity != (uint32_t) capacity) {
+                        args.GetReturnValue().Set(isolate->ThrowException(v8::Exception::Error(String::NewFromUtf8(isolate, "slots byte capacities must be integers from 0 to 65536.", NewStringType::kNormal).ToLocalChecked())));
+                        return;
+                    }
+                    added = slotSchema->add(SlotSchema::BYTES, (uint32_t) capacity);
+                } else {
+                    NativeString slotType(isolate, slot);
+                    if (slotType.isInvalid(args)) {
+                        return;
+                    }
+                    if (slotType.getString() == "int32") {
+                        added = slotSchema->add(SlotSchema::INT32);
+                    } else if (slotType.getString() == "float64") {
+                        added = slotSchema->add(SlotSchema::FLOAT64);
+                    } else {
+                        args.GetReturnValue().Set(isolate->ThrowException(v8::Exception::Error(String::NewFromUtf8(isolate, "slots must be 'int32', 'float64' or byte capacities.", NewStringType::kNormal).ToLocalChecked())));
+                        return;
+                    }
+                }
+
+                if (!added) {
+                    args.GetReturnValue().Set(isolate->ThrowException(v8::Exception::Error(String::NewFromUtf8(isolate, "slots must fit in 65536 bytes per WebSocket.", NewStringType::kNormal).ToLocalChecked())));
+                    return;
+                }
+            }
+        }
+
+        /* weakObjects or default, only meaningful with slots to keep the state in */
+        MaybeLocal<Value> maybeWeakObjects = behaviorObject->Get(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "weakObjects", NewStringType::kNormal).ToLocalChecked());
+        if (!maybeWeakObjects.IsEmpty() && maybeWeakObjects.ToLocalChecked()->BooleanValue(isolate)) {
+            if (!slotSchema) {
+                args.GetReturnValue().Set(isolate->ThrowException(v8::Exception::Error(String::NewFromUtf8(isolate, "weakObjects requires slots.", NewStringType::kNormal).ToLocalChecked())));
+                return;
+            }
+            slotSchema->weakObjects = true;
+        }
+
+        /* measureRtt or default, all behaviors of the app measuring it share one histogram */
+        MaybeLocal<Value> maybeMeasureRtt = behaviorObject->Get(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "measureRtt", NewStringType::kNormal).ToLocalChecked());
+        if (!maybeMeasureRtt.IsEmpty() && maybeMeasureRtt.ToLocalChecked()->BooleanValue(isolate)) {
+            std::shared_ptr<LatencyHistogram> &appRttHistogram = perContextData->rttHistograms[app];
+            if (!appRttHistogram) {
+                appRttHistogram = std::make_shared<LatencyHistogram>();
+            }
+            rttHistogram = appRttHistogram;
+        }
+
+        /* maxMessagesPerSecond or disabled */
+        MaybeLocal<Value> maybeMaxMessagesPerSecond = behaviorObject->Get(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "maxMessagesPerSecond", NewStringType::kNormal).ToLocalChecked());
+        if (!maybeMaxMessagesPerSecond.IsEmpty() && !maybeMaxMessagesPerSecond.ToLocalChecked()->IsUndefined()) {
+            rateLimit.maxMessagesPerSecond = maybeMaxMessagesPerSecond.ToLocalChecked()->Uint32Value(isolate->GetCurrentContext()).ToChecked();
+        }
+
+        /* maxBytesPerSecond or disabled */
+        MaybeLocal<Value> maybeMaxBytesPerSecond = behaviorObject->Get(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "maxBytesPerSecond", NewStringType::kNormal).ToLocalChecked());
+        if (!maybeMaxBytesPerSecond.IsEmpty() && !maybeMaxBytesPerSecond.ToLocalChecked()->IsUndefined()) {
+            rateLimit.maxBytesPerSecond = maybeMaxBytesPerSecond.ToLocalChecked()->Uint32Value(isolate->GetCurrentContext()).ToChecked();
+        }
+
+        /* closeOnRateLimit or default */
+        MaybeLocal<Value> maybeCloseOnRateLimit = behaviorObject->Get(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "closeOnRateLimit", NewStringType::kNormal).ToLocalChecked());
+        if (!maybeCloseOnRateLimit.IsEmpty() && !maybeCloseOnRateLimit.ToLocalChecked()->IsUndefined()) {
+            rateLimit.closeOnRateLimit = maybeCloseOnRateLimit.ToLocalChecked()->BooleanValue(isolate);
+        }
+
         /* Upgrade */
         upgradePf.Reset(args.GetIsolate(), Local<Function>::Cast(behaviorObject->Get(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "upgrade", NewStringType::kNormal).ToLocalChecked()).ToLocalChecked()));
         /* Open */
@@ -117,12 +267,20 @@ void uWS_App_ws(const FunctionCallbackInfo<Value> &args) {
         pongPf.Reset(args.GetIsolate(), Local<Function>::Cast(behaviorObject->Get(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "pong", NewStringType::kNormal).ToLocalChecked()).ToLocalChecked()));
     	/* Subscription */
         subscriptionPf.Reset(args.GetIsolate(), Local<Function>::Cast(behaviorObject->Get(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "subscription", NewStringType::kNormal).ToLocalChecked()).ToLocalChecked()));
+        /* Rate limited */
+        rateLimitedPf.Reset(args.GetIsolate(), Local<Function>::Cast(behaviorObject->Get(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "rateLimited", NewStringType::kNormal).ToLocalChecked()).ToLocalChecked()));
+        /* Parse error */
+        parseErrorPf.Reset(args.GetIsolate(), Local<Function>::Cast(behaviorObject->Get(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "parseError", NewStringType::kNormal).ToLocalChecked()).ToLocalChecked()));
 
     }
 
     /* Upgrade handler is always optional */
     if (upgradePf != Undefined(isolate)) {
-        behavior.upgrade = [upgradePf = std::move(upgradePf), perContextData](auto *res, auto *req, auto *context) {
+        behavior.upgrade = [upgradePf = std::move(upgradePf), perContextData, requestLimiter = getRequestLimiter(perContextData, app)](auto *res, auto *req, auto *context) {
+            if (rejectLimitedRequest<APP>(requestLimiter, res, req)) {
+                return;
+            }
+
             Isolate *isolate = perContextData->isolate;
             HandleScope hs(isolate);
 
@@ -137,6 +295,7 @@ void uWS_App_ws(const FunctionCallbackInfo<Value> &args) {
 
             Local<Value> argv[3] = {resObject, reqObject, External::New(isolate, (void *) context)};
             CallJS(isolate, upgradeLf, 3, argv);
+            passLimitedRequest<APP>(requestLimiter, res, req);
 
             /* Properly invalidate req */
             //reqObject->SetAlignedPointerInInternalField(0, nullptr);
@@ -145,10 +304,25 @@ void uWS_App_ws(const FunctionCallbackInfo<Value> &args) {
             /* µWS itself will terminate if not responded and not attached
             * onAborted handler, so we can assume it's done */
         };
+    } else if (RequestLimiter *requestLimiter = getRequestLimiter(perContextData, app)) {
+        /* µWS would upgrade right away, count the upgrade request like any other */
+        behavior.upgrade = [requestLimiter](auto *res, auto *req, auto *context) {
+            if (rejectLimitedRequest<APP>(requestLimiter, res, req)) {
+                return;
+            }
+
+            res->template upgrade<PerSocketData>({}, req->getHeader("sec-websocket-key"), req->getHeader("sec-websocket-protocol"),
+                req->getHeader("sec-websocket-extensions"), (struct us_socket_context_t *) context);
+        };
     }
 
+    /* Counted for all sockets of this behavior, replacing those of an earlier behavior of the same pattern */
+    std::shared_ptr<WebSocketStats> stats = std::make_shared<WebSocketStats>();
+    perContextData->webSocketStats[app][std::string(pattern.getString())] = stats;
+    bool closeOnBackpressureLimit = behavior.closeOnBackpressureLimit;
+
     /* Open handler is NOT optional for the wrapper */
-    behavior.open = [openPf = std::move(openPf), perContextData](auto *ws) {
+    behavior.open = [openPf = std::move(openPf), perContextData, rateLimit, conflationWatermark, maxCompressLength, maxBackpressure = behavior.maxBackpressure, slotSchema, stats, measureRtt = (bool) rttHistogram, app](auto *ws) {
         Isolate *isolate = perContextData->isolate;
         HandleScope hs(isolate);
 
@@ -189,7 +363,33 @@ void uWS_App_ws(const FunctionCallbackInfo<Value> &args) {
         }
 
         /* Attach a new V8 object with pointer to us, to it */
-        perSocketData->socketPf.Reset(isolate, wsObject);
+        if (slotSchema) {
+            perSocketData->slotSchema = slotSchema.get();
+            perSocketData->slots = (char *) calloc(1, slotSchema->size);
+        }
+        holdWsObject(isolate, perSocketData, wsObject);
+        perSocketData->app = app;
+        perSocketData->conflationWatermark = conflationWatermark;
+        perSocketData->maxBackpressure = maxBackpressure;
+        perSocketData->maxCompressLength = maxCompressLength;
+        perSocketData->stats = stats.get();
+
+        /* The socket is of no use without its fields */
+        if (slotSchema && !perSocketData->slots) {
+            ws->end(1011, "Out of memory");
+            return;
+        }
+
+        if (rateLimit.isEnabled()) {
+            rateLimit.fill(perSocketData);
+        }
+
+        /* The first sample comes right away, the rest follow automatic pings */
+        if (measureRtt) {
+            char probe[RttProbe::LENGTH];
+            ws->send(RttProbe::write(probe, perSocketData->rttProbeUs), uWS::OpCode::PING);
+            perSocketData->rttProbeOutstanding = true;
+        }
 
         Local<Function> openLf = Local<Function>::New(isolate, openPf);
         if (!openLf->IsUndefined()) {
@@ -198,101 +398,231 @@ void uWS_App_ws(const FunctionCallbackInfo<Value> &args) {
         }
     };
 
-    /* Message handler is always optional */
-    if (messagePf != Undefined(isolate)) {
-        behavior.message = [messagePf = std::move(messagePf), isolate](auto *ws, std::string_view message, uWS::OpCode opCode) {
+    /* Message handler is always optional, unless rate limiting */
+    if (messagePf != Undefined(isolate) || rateLimit.isEnabled()) {
+        bool hasRateLimitedHandler = !rateLimitedPf.IsEmpty() && rateLimitedPf != Undefined(isolate);
+        bool hasParseErrorHandler = !parseErrorPf.IsEmpty() && parseErrorPf != Undefined(isolate);
+        behavior.message = [messagePf = std::move(messagePf), rateLimitedPf = std::move(rateLimitedPf), parseErrorPf = std::move(parseErrorPf), hasRateLimitedHandler, hasParseErrorHandler, rateLimit, messageFormat, perContextData, isolate](auto *ws, std::string_view message, uWS::OpCode opCode) {
+            PerSocketData *perSocketData = (PerSocketData *) ws->getUserData();
+
+            /* Floods are shed here, without entering JS unless asked to */
+            bool limited = rateLimit.isEnabled() && !rateLimit.take(perSocketData, message.length());
+            if (limited && !hasRateLimitedHandler) {
+                if (rateLimit.closeOnRateLimit) {
+                    ws->end(1008, "Rate limit exceeded");
+                }
+                return;
+            }
+
             HandleScope hs(isolate);
 
-            Local<ArrayBuffer> messageArrayBuffer = ArrayBuffer_New(isolate, (void *) message.data(), message.length());
+            Local<Function> handlerLf = Local<Function>::New(isolate, limited ? rateLimitedPf : messagePf);
+            if (handlerLf->IsUndefined()) {
+                return;
+            }
 
-            PerSocketData *perSocketData = (PerSocketData *) ws->getUserData();
-            Local<Value> argv[3] = {Local<Object>::New(isolate, perSocketData->socketPf),
-                                    messageArrayBuffer,
-                                    Boolean::New(isolate, opCode == uWS::OpCode::BINARY)};
+            /* Text is valid UTF-8 as checked by µWS, and may be handed over as string or parsed JSON instead */
+            Local<Value> messageValue, parseError;
+            if (opCode == uWS::OpCode::TEXT && messageFormat != MessageFormat::ARRAYBUFFER) {
+                Local<String> messageString;
+                if (!String::NewFromUtf8(isolate, message.data(), NewStringType::kNormal, (int) message.length()).ToLocal(&messageString)) {
+                    ws->end(1009, "Message too big");
+                    return;
+                }
+                messageValue = messageString;
+
+                /* Text that is not JSON is handed over as the string it is, to parseError along with the exception if there is one */
+                if (messageFormat == MessageFormat::JSON) {
+                    TryCatch tryCatch(isolate);
+                    if (!JSON::Parse(isolate->GetCurrentContext(), messageString).ToLocal(&messageValue)) {
+                        parseError = tryCatch.Exception();
+                        messageValue = messageString;
+                    }
+                }
+            }
+            bool toParseError = !parseError.IsEmpty() && !limited && hasParseErrorHandler;
+            if (toParseError) {
+                handlerLf = Local<Function>::New(isolate, parseErrorPf);
+            }
+
+            Local<ArrayBuffer> messageArrayBuffer;
+            if (messageValue.IsEmpty()) {
+                messageArrayBuffer = ArrayBuffer_New(isolate, (void *) message.data(), message.length());
+                messageValue = messageArrayBuffer;
+            }
+
+            Local<Value> argv[3] = {getWsObject<APP>(perContextData, ws),
+                                    messageValue,
+                                    toParseError ? parseError : Boolean::New(isolate, opCode == uWS::OpCode::BINARY).As<Value>()};
 
-            CallJS(isolate, Local<Function>::New(isolate, messagePf), 3, argv);
+            CallJS(isolate, handlerLf, 3, argv);
 
             /* Important: we clear the ArrayBuffer to make sure it is not invalidly used after return */
-            messageArrayBuffer->Detach();
+            if (!messageArrayBuffer.IsEmpty()) {
+                messageArrayBuffer->Detach();
+            }
+
+            /* The rate limited handler may have closed the socket already */
+            if (limited && rateLimit.closeOnRateLimit && getInternalPointer(Local<Object>::Cast(argv[0]))) {
+                ws->end(1008, "Rate limit exceeded");
+            }
         };
     }
 
-    /* Dropped handler is always optional (similar to message) */
-    if (droppedPf != Undefined(isolate)) {
-        behavior.dropped = [droppedPf = std::move(droppedPf), isolate](auto *ws, std::string_view message, uWS::OpCode opCode) {
-            HandleScope hs(isolate);
+    /* Dropped handler is always optional (similar to message), but drops are always counted */
+    bool hasDroppedHandler = droppedPf != Undefined(isolate);
+    behavior.dropped = [droppedPf = std::move(droppedPf), hasDroppedHandler, closeOnBackpressureLimit, perContextData, isolate](auto *ws, std::string_view message, uWS::OpCode opCode) {
+        PerSocketData *perSocketData = (PerSocketData *) ws->getUserData();
 
-            Local<ArrayBuffer> messageArrayBuffer = ArrayBuffer_New(isolate, (void *) message.data(), message.length());
+        /* µWS drops past maxBackpressure, shutting down the socket on the first if closeOnBackpressureLimit */
+        WebSocketStats *stats = perSocketData->stats;
+        stats->droppedMessages++;
+        stats->droppedBytes += message.length();
+        stats->sampleBufferedAmount(ws->getBufferedAmount());
+        if (closeOnBackpressureLimit && !perSocketData->closingForBackpressure) {
+            perSocketData->closingForBackpressure = true;
+            stats->backpressureCloses++;
+        }
 
-            PerSocketData *perSocketData = (PerSocketData *) ws->getUserData();
-            Local<Value> argv[3] = {Local<Object>::New(isolate, perSocketData->socketPf),
-                                    messageArrayBuffer,
-                                    Boolean::New(isolate, opCode == uWS::OpCode::BINARY)};
+        if (!hasDroppedHandler) {
+            return;
+        }
 
-            CallJS(isolate, Local<Function>::New(isolate, droppedPf), 3, argv);
+        HandleScope hs(isolate);
 
-            /* Important: we clear the ArrayBuffer to make sure it is not invalidly used after return */
-            messageArrayBuffer->Detach();
-        };
-    }
+        Local<ArrayBuffer> messageArrayBuffer = ArrayBuffer_New(isolate, (void *) message.data(), message.length());
 
-    /* Drain handler is always optional */
-    if (drainPf != Undefined(isolate)) {
-        behavior.drain = [drainPf = std::move(drainPf), isolate](auto *ws) {
-            HandleScope hs(isolate);
+        Local<Value> argv[3] = {getWsObject<APP>(perContextData, ws),
+                                messageArrayBuffer,
+                                Boolean::New(isolate, opCode == uWS::OpCode::BINARY)};
 
-            PerSocketData *perSocketData = (PerSocketData *) ws->getUserData();
-            Local<Value> argv[1] = {Local<Object>::New(isolate, perSocketData->socketPf)
-                                    };
-            CallJS(isolate, Local<Function>::New(isolate, drainPf), 1, argv);
-        };
-    }
+        CallJS(isolate, Local<Function>::New(isolate, droppedPf), 3, argv);
+
+        /* Important: we clear the ArrayBuffer to make sure it is not invalidly used after return */
+        messageArrayBuffer->Detach();
+    };
+
+    /* Drain handler is always optional, but drain always resumes send streams or flushes deferred conflated publishes */
+    bool hasDrainHandler = drainPf != Undefined(isolate);
+    behavior.drain = [drainPf = std::move(drainPf), hasDrainHandler, perContextData, isolate](auto *ws) {
+        PerSocketData *perSocketData = (PerSocketData *) ws->getUserData();
+        perSocketData->stats->drains++;
+        perSocketData->stats->sampleBufferedAmount(ws->getBufferedAmount());
+
+        /* Deferred conflated publishes wait for the send stream to end. Either may close ws,
+         * which stays in memory until the next iteration marked closed */
+        if (getSendStream(ws)) {
+            pumpSendStream(isolate, ws);
+        } else {
+            flushConflated(ws);
+        }
+
+        if (!hasDrainHandler || perSocketData->closed) {
+            return;
+        }
+
+        HandleScope hs(isolate);
+
+        Local<Value> argv[1] = {getWsObject<APP>(perContextData, ws)
+                                };
+        CallJS(isolate, Local<Function>::New(isolate, drainPf), 1, argv);
+    };
 
     /* Subscription handler is always optional */
     if (subscriptionPf != Undefined(isolate)) {
-        behavior.subscription = [subscriptionPf = std::move(subscriptionPf), isolate](auto *ws, std::string_view topic, int newCount, int oldCount) {
+        behavior.subscription = [subscriptionPf = std::move(subscriptionPf), perContextData, isolate](auto *ws, std::string_view topic, int newCount, int oldCount) {
             HandleScope hs(isolate);
 
             PerSocketData *perSocketData = (PerSocketData *) ws->getUserData();
-            Local<Value> argv[4] = {Local<Object>::New(isolate, perSocketData->socketPf), ArrayBuffer_New(isolate, (void *) topic.data(), topic.length()), Integer::New(isolate, newCount), Integer::New(isolate, oldCount)};
+            Local<Value> argv[4] = {getWsObject<APP>(perContextData, ws), ArrayBuffer_New(isolate, (void *) topic.data(), topic.length()), Integer::New(isolate, newCount), Integer::New(isolate, oldCount)};
             CallJS(isolate, Local<Function>::New(isolate, subscriptionPf), 4, argv);
         };
     }
 
     /* Ping handler is always optional */
     if (pingPf != Undefined(isolate)) {
-        behavior.ping = [pingPf = std::move(pingPf), isolate](auto *ws, std::string_view message) {
+        behavior.ping = [pingPf = std::move(pingPf), perContextData, isolate](auto *ws, std::string_view message) {
             HandleScope hs(isolate);
 
             PerSocketData *perSocketData = (PerSocketData *) ws->getUserData();
-            Local<Value> argv[2] = {Local<Object>::New(isolate, perSocketData->socketPf), ArrayBuffer_New(isolate, (void *) message.data(), message.length())};
+            Local<Value> argv[2] = {getWsObject<APP>(perContextData, ws), ArrayBuffer_New(isolate, (void *) message.data(), message.length())};
             CallJS(isolate, Local<Function>::New(isolate, pingPf), 2, argv);
         };
     }
 
-    /* Pong handler is always optional */
-    if (pongPf != Undefined(isolate)) {
-        behavior.pong = [pongPf = std::move(pongPf), isolate](auto *ws, std::string_view message) {
+    /* Pong handler is always optional, unless measuring RTT */
+    if (pongPf != Undefined(isolate) || rttHistogram) {
+        bool hasPongHandler = pongPf != Undefined(isolate);
+        behavior.pong = [pongPf = std::move(pongPf), hasPongHandler, rttHistogram, perContextData, isolate](auto *ws, std::string_view message) {
+            PerSocketData *perSocketData = (PerSocketData *) ws->getUserData();
+
+            if (rttHistogram) {
+                /* Pongs carrying probes never reach JS, and only the one answering the outstanding probe is a sample */
+                if (RttProbe::isProbe(message)) {
+                    uint64_t rttUs;
+                    if (perSocketData->rttProbeOutstanding && RttProbe::read(message, perSocketData->rttProbeUs, rttUs)) {
+                        perSocketData->rttProbeOutstanding = false;
+                        rttHistogram->record(rttUs);
+                        float rtt = (float) rttUs / 1000.0f;
+                        perSocketData->rtt = perSocketData->rtt ? perSocketData->rtt + (rtt - perSocketData->rtt) / 8 : rtt;
+                    }
+                    return;
+                }
+
+                /* Automatic pings carry nothing and are answered by a probe, measuring once per ping interval.
+                 * Unsolicited empty pongs do not make us probe more often than that. A probe left unanswered is replaced */
+                if (message.empty() && RttProbe::nowUs() - perSocketData->rttProbeUs >= RttProbe::INTERVAL_US) {
+                    char probe[RttProbe::LENGTH];
+                    ws->send(RttProbe::write(probe, perSocketData->rttProbeUs), uWS::OpCode::PING);
+                    perSocketData->rttProbeOutstanding = true;
+                }
+            }
+
+            if (!hasPongHandler) {
+                return;
+            }
+
             HandleScope hs(isolate);
 
-            PerSocketData *perSocketData = (PerSocketData *) ws->getUserData();
-            Local<Value> argv[2] = {Local<Object>::New(isolate, perSocketData->socketPf), ArrayBuffer_New(isolate, (void *) message.data(), message.length())};
+            Local<Value> argv[2] = {getWsObject<APP>(perContextData, ws), ArrayBuffer_New(isolate, (void *) message.data(), message.length())};
             CallJS(isolate, Local<Function>::New(isolate, pongPf), 2, argv);
         };
     }
 
     /* Close handler is NOT optional for the wrapper */
-    behavior.close = [closePf = std::move(closePf), isolate](auto *ws, int code, std::string_view message) {
+    behavior.close = [closePf = std::move(closePf), perContextData, isolate](auto *ws, int code, std::string_view message) {
         HandleScope hs(isolate);
 
         Local<ArrayBuffer> messageArrayBuffer = ArrayBuffer_New(isolate, (void *) message.data(), message.length());
         PerSocketData *perSocketData = (PerSocketData *) ws->getUserData();
-        Local<Object> wsObject = Local<Object>::New(isolate, perSocketData->socketPf);
+        Local<Object> wsObject = getWsObject<APP>(perContextData, ws);
+
+        perSocketData->closed = true;
 
         /* Invalidate this wsObject */
         //wsObject->SetAlignedPointerInInternalField(0, nullptr);
         setInternalPointer(wsObject, nullptr);
 
+        /* Timers of this socket never fire after close */
+        clearSocketTimers(ws);
+
+        perSocketData->stats->sampleBufferedAmount(ws->getBufferedAmount());
+
+        /* Nor do wildcard publishes reach it */
+        if (AppWildcardTopics *wildcardTopics = getAppWildcardTopics(perSocketData->app)) {
+            wildcardTopics->topics.unsubscribeAll(ws);
+        }
+
+        /* Nor does what was deferred for it */
+        dropConflated(ws);
+
+        /* Streams end as failed */
+        dropSendStream(isolate, ws);
+
+        /* Native fields go with the socket, wsObject can no longer reach them */
+        free(perSocketData->slots);
+        perSocketData->slots = nullptr;
+
         /* Only call close handler if we have one set */
         Local<Function> closeLf = Local<Function>::New(isolate, closePf);
         if (!closeLf->IsUndefined()) {
@@ -314,6 +644,48 @@ void uWS_App_ws(const FunctionCallbackInfo<Value> &args) {
 }
 
 /* This method wraps get, post and all http methods */
+/* Returns the request rate limit of this app, if any */
+static inline RequestLimiter *getRequestLimiter(PerContextData *perContextData, void *app) {
+    auto it = perContextData->requestLimiters.find(app);
+    return it == perContextData->requestLimiters.end() ? nullptr : it->second.get();
+}
+
+/* The request last handed on to the next matching route with setYield, which the yielding route counted already.
+ * A request yielded to no route gets its socket closed by µWS, the marker is then dropped after the loop iteration */
+struct YieldedRequest {
+    void *res;
+    const char *url;
+};
+thread_local YieldedRequest yieldedRequest = {};
+
+/* Answers 429 without calling into JS if the client is over the request rate limit, counting every request once */
+template <typename APP, typename RES, typename REQ>
+static inline bool rejectLimitedRequest(RequestLimiter *requestLimiter, RES *res, REQ *req) {
+    if constexpr (!std::is_same<APP, uWS::H3App>::value) {
+        if (requestLimiter) {
+            if (yieldedRequest.res == res && yieldedRequest.url == req->getUrl().data()) {
+                yieldedRequest = {};
+                return false;
+            }
+            if (!requestLimiter->allow(requestLimiter->useProxiedAddress ? res->getProxiedRemoteAddress() : res->getRemoteAddress())) {
+                res->writeStatus("429 Too Many Requests")->end();
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/* Called once a route is done with a request, remembering it as counted if it was yielded on */
+template <typename APP, typename RES, typename REQ>
+static inline void passLimitedRequest(RequestLimiter *requestLimiter, RES *res, REQ *req) {
+    if constexpr (!std::is_same<APP, uWS::H3App>::value) {
+        if (requestLimiter && req->getYield()) {
+            yieldedRequest = {res, req->getUrl().data()};
+        }
+    }
+}
+
 template <typename APP, typename F>
 void uWS_App_get(F f, const FunctionCallbackInfo<Value> &args) {
     APP *app = (APP *) getInternalPointer(args.This());//->GetAlignedPointerFromInternalField(0);
@@ -331,6 +703,9 @@ void uWS_App_get(F f, const FunctionCallbackInfo<Value> &args) {
         return;
     }
 
+    /* This function requires perContextData */
+    PerContextData *perContextData = (PerContextData *) Local<External>::Cast(args.Data())->Value();
+
     /* If the handler is String */
     if (args[1]->IsArrayBuffer()) {
         NativeString constantString(args.GetIsolate(), args[1]);
@@ -338,8 +713,10 @@ void uWS_App_get(F f, const FunctionCallbackInfo<Value> &args) {
             return;
         }
 
-        (app->*f)(std::string(pattern.getString()), [response = std::string(constantString.getString().data(), constantString.getString().length())](auto *res, auto *req) {
-            
+        (app->*f)(std::string(pattern.getString()), [response = std::string(constantString.getString().data(), constantString.getString().length()), requestLimiter = getRequestLimiter(perContextData, app)](auto *res, auto *req) {
+            if (rejectLimitedRequest<APP>(requestLimiter, res, req)) {
+                return;
+            }
 
             if constexpr (!std::is_same<APP, uWS::H3App>::value) {
 
@@ -461,10 +838,11 @@ void uWS_App_get(F f, const FunctionCallbackInfo<Value> &args) {
     }
     UniquePersistent<Function> cb = checkedCallback.getFunction();
 
-    /* This function requires perContextData */
-    PerContextData *perContextData = (PerContextData *) Local<External>::Cast(args.Data())->Value();
+    (app->*f)(std::string(pattern.getString()), [cb = std::move(cb), perContextData, requestLimiter = getRequestLimiter(perContextData, app)](auto *res, auto *req) {
+        if (rejectLimitedRequest<APP>(requestLimiter, res, req)) {
+            return;
+        }
 
-    (app->*f)(std::string(pattern.getString()), [cb = std::move(cb), perContextData](auto *res, auto *req) {
         Isolate *isolate = perContextData->isolate;
         HandleScope hs(isolate);
 
@@ -478,6 +856,7 @@ void uWS_App_get(F f, const FunctionCallbackInfo<Value> &args) {
 
         Local<Value> argv[] = {resObject, reqObject};
         CallJS(isolate, cb.Get(isolate), 2, argv);
+        passLimitedRequest<APP>(requestLimiter, res, req);
 
         /* Properly invalidate req */
         //reqObject->SetAlignedPointerInInternalField(0, nullptr);
@@ -490,6 +869,276 @@ void uWS_App_get(F f, const FunctionCallbackInfo<Value> &args) {
     args.GetReturnValue().Set(args.This());
 }
 
+/* Takes prefix, directory and options, serves GET and HEAD of files below directory under prefix natively */
+template <typename APP>
+void uWS_App_static(const FunctionCallbackInfo<Value> &args) {
+    APP *app = (APP *) getInternalPointer(args.This());//->GetAlignedPointerFromInternalField(0);
+
+    Isolate *isolate = args.GetIsolate();
+    PerContextData *perContextData = (PerContextData *) Local<External>::Cast(args.Data())->Value();
+
+    if (missingArguments(2, args)) {
+        return;
+    }
+
+    NativeString prefix(isolate, args[0]);
+    if (prefix.isInvalid(args)) {
+        return;
+    }
+
+    NativeString directory(isolate, args[1]);
+    if (directory.isInvalid(args)) {
+        return;
+    }
+
+    std::shared_ptr<StaticFiles> staticFiles = std::make_shared<StaticFiles>();
+    staticFiles->prefix = prefix.getString();
+    while (staticFiles->prefix.length() && staticFiles->prefix.back() == '/') {
+        staticFiles->prefix.pop_back();
+    }
+    staticFiles->directory = directory.getString();
+    while (staticFiles->directory.length() > 1 && staticFiles->directory.back() == '/') {
+        staticFiles->directory.pop_back();
+    }
+
+    if (args.Length() > 2 && args[2]->IsObject()) {
+        Local<Object> optionsObject = Local<Object>::Cast(args[2]);
+
+        /* index or default */
+        MaybeLocal<Value> maybeIndex = optionsObject->Get(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "index", NewStringType::kNormal).ToLocalChecked());
+        if (!maybeIndex.IsEmpty() && !maybeIndex.ToLocalChecked()->IsUndefined()) {
+            NativeString index(isolate, maybeIndex.ToLocalChecked());
+            if (index.isInvalid(args)) {
+                return;
+            }
+            staticFiles->index = index.getString();
+        }
+
+        /* cacheControl or none */
+        MaybeLocal<Value> maybeCacheControl = optionsObject->Get(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "cacheControl", NewStringType::kNormal).ToLocalChecked());
+        if (!maybeCacheControl.IsEmpty() && !maybeCacheControl.ToLocalChecked()->IsUndefined()) {
+            NativeString cacheControl(isolate, maybeCacheControl.ToLocalChecked());
+            if (cacheControl.isInvalid(args)) {
+                return;
+            }
+            staticFiles->cacheControl = cacheControl.getString();
+        }
+
+        /* maxOpenFiles or default */
+        MaybeLocal<Value> maybeMaxOpenFiles = optionsObject->Get(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "maxOpenFiles", NewStringType::kNormal).ToLocalChecked());
+        if (!maybeMaxOpenFiles.IsEmpty() && !maybeMaxOpenFiles.ToLocalChecked()->IsUndefined()) {
+            staticFiles->maxOpenFiles = std::max<uint32_t>(1, maybeMaxOpenFiles.ToLocalChecked()->Uint32Value(isolate->GetCurrentContext()).ToChecked());
+        }
+    }
+
+    std::string pattern = staticFiles->prefix + "/*";
+    app->get(pattern, [staticFiles, requestLimiter = getRequestLimiter(perContextData, app)](auto *res, auto *req) {
+        if (rejectLimitedRequest<APP>(requestLimiter, res, req)) {
+            return;
+        }
+        staticFiles->serve(res, req, false);
+    });
+    app->head(pattern, [staticFiles, requestLimiter = getRequestLimiter(perContextData, app)](auto *res, auto *req) {
+        if (rejectLimitedRequest<APP>(requestLimiter, res, req)) {
+            return;
+        }
+        staticFiles->serve(res, req, true);
+    });
+
+    args.GetReturnValue().Set(args.This());
+}
+
+/* Returns the asset cache of app, made on first use */
+static inline std::shared_ptr<AssetCache> &getAssetCache(PerContextData *perContextData, void *app) {
+    std::shared_ptr<AssetCache> &assetCache = perContextData->assetCaches[app];
+    if (!assetCache) {
+        assetCache = std::make_shared<AssetCache>();
+    }
+    return assetCache;
+}
+
+/* Serves GET and HEAD of pattern from the asset cache, yielding to the next route if there is no such asset */
+template <typename APP>
+static void routeAssets(APP *app, PerContextData *perContextData, std::string pattern) {
+    std::shared_ptr<AssetCache> assetCache = getAssetCache(perContextData, app);
+    RequestLimiter *requestLimiter = getRequestLimiter(perContextData, app);
+
+    app->get(pattern, [assetCache, requestLimiter](auto *res, auto *req) {
+        const AssetCache::Asset *asset = assetCache->find(req->getUrl());
+        if (!asset) {
+            req->setYield(true);
+            return;
+        }
+        if (rejectLimitedRequest<APP>(requestLimiter, res, req)) {
+            return;
+        }
+        AssetCache::serve(res, req, asset, false);
+    });
+    app->head(pattern, [assetCache, requestLimiter](auto *res, auto *req) {
+        const AssetCache::Asset *asset = assetCache->find(req->getUrl());
+        if (!asset) {
+            req->setYield(true);
+            return;
+        }
+        if (rejectLimitedRequest<APP>(requestLimiter, res, req)) {
+            return;
+        }
+        AssetCache::serve(res, req, asset, true);
+    });
+}
+
+/* Takes prefix, optional directory and options. Serves the assets below prefix, loading those of directory */
+template <typename APP>
+void uWS_App_assets(const FunctionCallbackInfo<Value> &args) {
+    APP *app = (APP *) getInternalPointer(args.This());//->GetAlignedPointerFromInternalField(0);
+
+    Isolate *isolate = args.GetIsolate();
+    PerContextData *perContextData = (PerContextData *) Local<External>::Cast(args.Data())->Value();
+
+    NativeString prefixValue(isolate, args[0]);
+    if (prefixValue.isInvalid(args)) {
+        return;
+    }
+    std::string_view prefix = prefixValue.getString();
+    while (prefix.length() && prefix.back() == '/') {
+        prefix.remove_suffix(1);
+    }
+
+    std::shared_ptr<AssetCache> &assetCache = getAssetCache(perContextData, app);
+
+    if (args.Length() > 2 && args[2]->IsObject()) {
+        Local<Object> optionsObject = Local<Object>::Cast(args[2]);
+
+        /* index or default */
+        MaybeLocal<Value> maybeIndex = optionsObject->Get(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "index", NewStringType::kNormal).ToLocalChecked());
+        if (!maybeIndex.IsEmpty() && !maybeIndex.ToLocalChecked()->IsUndefined()) {
+            NativeString index(isolate, maybeIndex.ToLocalChecked());
+            if (index.isInvalid(args)) {
+                return;
+            }
+            assetCache->index = index.getString();
+        }
+
+        /* cacheControl or none */
+        MaybeLocal<Value> maybeCacheControl = optionsObject->Get(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "cacheControl", NewStringType::kNormal).ToLocalChecked());
+        if (!maybeCacheControl.IsEmpty() && !maybeCacheControl.ToLocalChecked()->IsUndefined()) {
+            NativeString cacheControl(isolate, maybeCacheControl.ToLocalChecked());
+            if (cacheControl.isInvalid(args)) {
+                return;
+            }
+            assetCache->cacheControl = cacheControl.getString();
+        }
+
+        /* maxFileSize or default */
+        MaybeLocal<Value> maybeMaxFileSize = optionsObject->Get(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "maxFileSize", NewStringType::kNormal).ToLocalChecked());
+        if (!maybeMaxFileSize.IsEmpty() && !maybeMaxFileSize.ToLocalChecked()->IsUndefined()) {
+            assetCache->maxFileSize = maybeMaxFileSize.ToLocalChecked()->Uint32Value(isolate->GetCurrentContext()).ToChecked();
+        }
+    }
+
+    if (args.Length() > 1 && !args[1]->IsUndefined() && !args[1]->IsNull()) {
+        NativeString directory(isolate, args[1]);
+        if (directory.isInvalid(args)) {
+            return;
+        }
+        if (assetCache->load(prefix, std::string(directory.getString())) == -1) {
+            args.GetReturnValue().Set(isolate->ThrowException(v8::Exception::Error(String::NewFromUtf8(isolate, "Could not read the directory of assets.", NewStringType::kNormal).ToLocalChecked())));
+            return;
+        }
+    }
+
+    if (assetCache->addPrefix(prefix)) {
+        routeAssets(app, perContextData, std::string(prefix) + "/*");
+    }
+
+    args.GetReturnValue().Set(args.This());
+}
+
+/* Takes URL, data and options of contentType, gzip and br. Adds or replaces the asset of URL */
+template <typename APP>
+void uWS_App_setAsset(const FunctionCallbackInfo<Value> &args) {
+    APP *app = (APP *) getInternalPointer(args.This());//->GetAlignedPointerFromInternalField(0);
+
+    Isolate *isolate = args.GetIsolate();
+    PerContextData *perContextData = (PerContextData *) Local<External>::Cast(args.Data())->Value();
+
+    if (missingArguments(2, args)) {
+        return;
+    }
+
+    NativeString url(isolate, args[0]);
+    if (url.isInvalid(args)) {
+        return;
+    }
+
+    NativeString<true> data(isolate, args[1]);
+    if (data.isInvalid(args)) {
+        return;
+    }
+
+    std::string contentType, gzipBody, brotliBody;
+    if (args.Length() > 2 && args[2]->IsObject()) {
+        Local<Object> optionsObject = Local<Object>::Cast(args[2]);
+
+        MaybeLocal<Value> maybeContentType = optionsObject->Get(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "contentType", NewStringType::kNormal).ToLocalChecked());
+        if (!maybeContentType.IsEmpty() && !maybeContentType.ToLocalChecked()->IsUndefined()) {
+            NativeString contentTypeValue(isolate, maybeContentType.ToLocalChecked());
+            if (contentTypeValue.isInvalid(args)) {
+                return;
+            }
+            contentType = contentTypeValue.getString();
+        }
+
+        /* Precompressed codings, brotli can only be given */
+        MaybeLocal<Value> maybeGzip = optionsObject->Get(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "gzip", NewStringType::kNormal).ToLocalChecked());
+        if (!maybeGzip.IsEmpty() && !maybeGzip.ToLocalChecked()->IsUndefined()) {
+            NativeString<true> gzipValue(isolate, maybeGzip.ToLocalChecked());
+            if (gzipValue.isInvalid(args)) {
+                return;
+            }
+            gzipBody = gzipValue.getString();
+        }
+
+        MaybeLocal<Value> maybeBrotli = optionsObject->Get(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "br", NewStringType::kNormal).ToLocalChecked());
+        if (!maybeBrotli.IsEmpty() && !maybeBrotli.ToLocalChecked()->IsUndefined()) {
+            NativeString<true> brotliValue(isolate, maybeBrotli.ToLocalChecked());
+            if (brotliValue.isInvalid(args)) {
+                return;
+            }
+            brotliBody = brotliValue.getString();
+        }
+    }
+    if (contentType.empty()) {
+        contentType = OpenFile::contentTypeOf(url.getString());
+    }
+
+    std::shared_ptr<AssetCache> &assetCache = getAssetCache(perContextData, app);
+    assetCache->set(url.getString(), std::string(data.getString()), contentType, std::move(gzipBody), std::move(brotliBody));
+
+    if (assetCache->addUrl(url.getString())) {
+        routeAssets(app, perContextData, std::string(url.getString()));
+    }
+
+    args.GetReturnValue().Set(args.This());
+}
+
+/* Takes URL, returns whether there was an asset of it */
+template <typename APP>
+void uWS_App_removeAsset(const FunctionCallbackInfo<Value> &args) {
+    APP *app = (APP *) getInternalPointer(args.This());//->GetAlignedPointerFromInternalField(0);
+
+    Isolate *isolate = args.GetIsolate();
+    PerContextData *perContextData = (PerContextData *) Local<External>::Cast(args.Data())->Value();
+
+    NativeString url(isolate, args[0]);
+    if (url.isInvalid(args)) {
+        return;
+    }
+
+    auto it = perContextData->assetCaches.find(app);
+    args.GetReturnValue().Set(Boolean::New(isolate, it != perContextData->assetCaches.end() && it->second->remove(url.getString())));
+}
+
 template <typename APP>
 void uWS_App_close(const FunctionCallbackInfo<Value> &args) {
     APP *app = (APP *) getInternalPointer(args.This());//->GetAlignedPointerFromInternalField(0);
@@ -630,7 +1279,7 @@ void uWS_App_publish(const FunctionCallbackInfo<Value> &args) {
 
     Isolate *isolate = args.GetIsolate();
 
-    /* topic, message [isBinary, compress] */
+    /* topic, message [isBinary, compress, conflate] */
     if (missingArguments(2, args)) {
         return;
     }
@@ -640,16 +1289,158 @@ void uWS_App_publish(const FunctionCallbackInfo<Value> &args) {
         return;
     }
 
+    /* Only the latest message of a conflated topic reaches subscribers over their watermark */
+    bool conflate = args[4]->BooleanValue(isolate);
+
     NativeString message(isolate, args[1]);
     if (message.isInvalid(args)) {
         return;
     }
 
-    bool ok = app->publish(topic.getString(), message.getString(), args[2]->BooleanValue(isolate) ? uWS::OpCode::BINARY : uWS::OpCode::TEXT, args[3]->BooleanValue(isolate));
+    uWS::OpCode opCode = args[2]->BooleanValue(isolate) ? uWS::OpCode::BINARY : uWS::OpCode::TEXT;
+    bool ok = conflate ? publishConflated(app, topic.getString(), message.getString(), opCode, args[3]->BooleanValue(isolate))
+        : app->publish(topic.getString(), message.getString(), opCode, args[3]->BooleanValue(isolate));
+    ok |= publishToWildcardSubscribers(app, topic.getString(), message.getString(), opCode, args[3]->BooleanValue(isolate)) > 0;
+    ok |= publishToSendStreams(app, topic.getString(), message.getString(), opCode, args[3]->BooleanValue(isolate), conflate) > 0;
+    countPublish(app, topic.getString(), message.getString().length());
 
     args.GetReturnValue().Set(Boolean::New(isolate, ok));
 }
 
+/* Publishes messages[i] under topics[i], or one message under all topics, in one call */
+template <typename APP>
+void uWS_App_publishBatch(const FunctionCallbackInfo<Value> &args) {
+    APP *app = (APP *) getInternalPointer(args.This());//->GetAlignedPointerFromInternalField(0);
+
+    Isolate *isolate = args.GetIsolate();
+
+    /* topics, messages [isBinary, compress] */
+    if (missingArguments(2, args)) {
+        return;
+    }
+
+    if (!args[0]->IsArray() || (args[1]->IsArray() && Local<Array>::Cast(args[1])->Length() != Local<Array>::Cast(args[0])->Length())) {
+        args.GetReturnValue().Set(isolate->ThrowException(v8::Exception::Error(String::NewFromUtf8(isolate, "Topics must be an array, and messages either one message or an array of the same length.", NewStringType::kNormal).ToLocalChecked())));
+        return;
+    }
+
+    Local<Array> topics = Local<Array>::Cast(args[0]);
+    uWS::OpCode opCode = args[2]->BooleanValue(isolate) ? uWS::OpCode::BINARY : uWS::OpCode::TEXT;
+    bool compress = args[3]->BooleanValue(isolate);
+
+    /* The topic tree buffers these and drains them per subscriber, so subscribers of
+     * many of these topics get their messages in one send */
+    uint32_t published = 0;
+    for (uint32_t i = 0; i < topics->Length(); i++) {
+        NativeString topic(isolate, topics->Get(isolate->GetCurrentContext(), i).ToLocalChecked());
+        if (topic.isInvalid(args)) {
+            return;
+        }
+
+        Local<Value> messageValue = args[1]->IsArray() ? Local<Array>::Cast(args[1])->Get(isolate->GetCurrentContext(), i).ToLocalChecked() : args[1];
+        NativeString message(isolate, messageValue);
+        if (message.isInvalid(args)) {
+            return;
+        }
+
+        published += app->publish(topic.getString(), message.getString(), opCode, compress)
+            | (publishToWildcardSubscribers(app, topic.getString(), message.getString(), opCode, compress) > 0)
+            | (publishToSendStreams(app, topic.getString(), message.getString(), opCode, compress, false) > 0);
+        countPublish(app, topic.getString(), message.getString().length());
+    }
+
+    /* Returns how many publishes succeeded */
+    args.GetReturnValue().Set(Integer::NewFromUnsigned(isolate, published));
+}
+
+/* Cross-thread publishing. Every thread with apps has a queue in the registry, drained on its own loop */
+struct Publication {
+    std::string topic;
+    std::string message;
+    uWS::OpCode opCode;
+    bool compress;
+};
+
+std::vector<LoopQueue<std::shared_ptr<const Publication>> *> publicationQueues;
+std::mutex publicationQueuesMutex;
+thread_local LoopQueue<std::shared_ptr<const Publication>> *publicationQueue = nullptr;
+
+/* Publishes to the apps of this thread */
+void publishLocally(PerContextData *perContextData, std::string_view topic, std::string_view message, uWS::OpCode opCode, bool compress) {
+    for (auto &app : perContextData->apps) {
+        app->publish(topic, message, opCode, compress);
+        publishToWildcardSubscribers(app.get(), topic, message, opCode, compress);
+        publishToSendStreams(app.get(), topic, message, opCode, compress, false);
+        countPublish(app.get(), topic, message.length());
+    }
+    for (auto &sslApp : perContextData->sslApps) {
+        sslApp->publish(topic, message, opCode, compress);
+        publishToWildcardSubscribers(sslApp.get(), topic, message, opCode, compress);
+        publishToSendStreams(sslApp.get(), topic, message, opCode, compress, false);
+        countPublish(sslApp.get(), topic, message.length());
+    }
+}
+
+/* Called when this thread creates its first app */
+void joinPublicationQueues(PerContextData *perContextData) {
+    if (publicationQueue) {
+        return;
+    }
+
+    publicationQueue = new LoopQueue<std::shared_ptr<const Publication>>(uWS::Loop::get(), [perContextData](std::vector<std::shared_ptr<const Publication>> &publications) {
+        for (auto &publication : publications) {
+            publishLocally(perContextData, publication->topic, publication->message, publication->opCode, publication->compress);
+        }
+    });
+
+    std::lock_guard<std::mutex> lock(publicationQueuesMutex);
+    publicationQueues.push_back(publicationQueue);
+}
+
+/* Called before freeing the loop of this thread, the queue itself is freed after the loop */
+void leavePublicationQueues() {
+    if (!publicationQueue) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(publicationQueuesMutex);
+    std::erase(publicationQueues, publicationQueue);
+}
+
+/* Takes topic, message [isBinary, compress]. Publishes to the apps of this thread immediately and to the
+ * apps of all other threads as soon as their loops wake up. The message is copied once and shared by all threads */
+void uWS_publish(const FunctionCallbackInfo<Value> &args) {
+    Isolate *isolate = args.GetIsolate();
+
+    PerContextData *perContextData = (PerContextData *) Local<External>::Cast(args.Data())->Value();
+
+    if (missingArguments(2, args)) {
+        return;
+    }
+
+    NativeString topic(isolate, args[0]);
+    if (topic.isInvalid(args)) {
+        return;
+    }
+
+    NativeString message(isolate, args[1]);
+    if (message.isInvalid(args)) {
+        return;
+    }
+
+    auto publication = std::make_shared<Publication>(Publication {std::string(topic.getString()), std::string(message.getString()),
+        args[2]->BooleanValue(isolate) ? uWS::OpCode::BINARY : uWS::OpCode::TEXT, args[3]->BooleanValue(isolate)});
+
+    publishLocally(perContextData, publication->topic, publication->message, publication->opCode, publication->compress);
+
+    std::lock_guard<std::mutex> lock(publicationQueuesMutex);
+    for (auto *queue : publicationQueues) {
+        if (queue != publicationQueue) {
+            queue->push(publication);
+        }
+    }
+}
+
 template <typename APP>
 void uWS_App_numSubscribers(const FunctionCallbackInfo<Value> &args) {
     APP *app = (APP *) getInternalPointer(args.This());//->GetAlignedPointerFromInternalField(0);
@@ -669,6 +1460,137 @@ void uWS_App_numSubscribers(const FunctionCallbackInfo<Value> &args) {
     args.GetReturnValue().Set(Integer::New(isolate, app->numSubscribers(topic.getString())));
 }
 
+/* Takes array of topics, returns Int32Array of their number of subscribers */
+template <typename APP>
+void uWS_App_numSubscribersMany(const FunctionCallbackInfo<Value> &args) {
+    APP *app = (APP *) getInternalPointer(args.This());//->GetAlignedPointerFromInternalField(0);
+
+    Isolate *isolate = args.GetIsolate();
+
+    if (!args[0]->IsArray()) {
+        args.GetReturnValue().Set(isolate->ThrowException(v8::Exception::Error(String::NewFromUtf8(isolate, "numSubscribersMany requires an array of topics.", NewStringType::kNormal).ToLocalChecked())));
+        return;
+    }
+
+    Local<Array> topics = Local<Array>::Cast(args[0]);
+    uint32_t length = topics->Length();
+    Local<ArrayBuffer> countsArrayBuffer = ArrayBuffer::New(isolate, length * sizeof(int32_t));
+    int32_t *counts = (int32_t *) countsArrayBuffer->GetBackingStore()->Data();
+
+    for (uint32_t i = 0; i < length; i++) {
+        NativeString topic(isolate, topics->Get(isolate->GetCurrentContext(), i).ToLocalChecked());
+        if (topic.isInvalid(args)) {
+            return;
+        }
+        counts[i] = (int32_t) app->numSubscribers(topic.getString());
+    }
+
+    args.GetReturnValue().Set(Int32Array::New(countsArrayBuffer, 0, length));
+}
+
+/* Takes function of topic, subscribers, publishes and bytes, called for every topic published to since last call */
+template <typename APP>
+void uWS_App_topicStats(const FunctionCallbackInfo<Value> &args) {
+    APP *app = (APP *) getInternalPointer(args.This());//->GetAlignedPointerFromInternalField(0);
+
+    Isolate *isolate = args.GetIsolate();
+
+    Callback checkedCallback(isolate, args[0]);
+    if (checkedCallback.isInvalid(args)) {
+        return;
+    }
+    UniquePersistent<Function> cb = checkedCallback.getFunction();
+
+    auto it = appTopicStats.find(app);
+    if (it == appTopicStats.end()) {
+        args.GetReturnValue().Set(isolate->ThrowException(v8::Exception::Error(String::NewFromUtf8(isolate, "topicStats requires the topicStats app option.", NewStringType::kNormal).ToLocalChecked())));
+        return;
+    }
+
+    /* Taken first, the callback may publish */
+    std::unordered_map<std::string, TopicStats::Counters, TopicStats::Hash, std::equal_to<>> topics = std::move(it->second.topics);
+    it->second.topics.clear();
+
+    Local<Function> cbLocal = Local<Function>::New(isolate, cb);
+    for (auto &[topic, counters] : topics) {
+        HandleScope hs(isolate);
+        Local<Value> argv[4] = {
+            String::NewFromUtf8(isolate, topic.data(), NewStringType::kNormal, (int) topic.length()).ToLocalChecked(),
+            Integer::NewFromUnsigned(isolate, app->numSubscribers(topic)),
+            Number::New(isolate, (double) counters.publishes),
+            Number::New(isolate, (double) counters.bytes)
+        };
+        if (cbLocal->Call(isolate->GetCurrentContext(), isolate->GetCurrentContext()->Global(), 4, argv).IsEmpty()) {
+            return;
+        }
+    }
+
+    args.GetReturnValue().Set(args.This());
+}
+
+/* Returns the slow consumer counters of the WebSocket behavior of pattern, undefined if there is none */
+template <typename APP>
+void uWS_App_wsStats(const FunctionCallbackInfo<Value> &args) {
+    APP *app = (APP *) getInternalPointer(args.This());//->GetAlignedPointerFromInternalField(0);
+
+    Isolate *isolate = args.GetIsolate();
+    PerContextData *perContextData = (PerContextData *) Local<External>::Cast(args.Data())->Value();
+
+    NativeString pattern(isolate, args[0]);
+    if (pattern.isInvalid(args)) {
+        return;
+    }
+
+    auto appStats = perContextData->webSocketStats.find(app);
+    if (appStats == perContextData->webSocketStats.end()) {
+        return;
+    }
+    auto it = appStats->second.find(std::string(pattern.getString()));
+    if (it == appStats->second.end()) {
+        return;
+    }
+    WebSocketStats *stats = it->second.get();
+
+    Local<Context> context = isolate->GetCurrentContext();
+    Local<Object> statsObject = Object::New(isolate);
+    statsObject->Set(context, String::NewFromUtf8(isolate, "droppedMessages", NewStringType::kNormal).ToLocalChecked(), Number::New(isolate, (double) stats->droppedMessages)).ToChecked();
+    statsObject->Set(context, String::NewFromUtf8(isolate, "droppedBytes", NewStringType::kNormal).ToLocalChecked(), Number::New(isolate, (double) stats->droppedBytes)).ToChecked();
+    statsObject->Set(context, String::NewFromUtf8(isolate, "backpressureCloses", NewStringType::kNormal).ToLocalChecked(), Number::New(isolate, (double) stats->backpressureCloses)).ToChecked();
+    statsObject->Set(context, String::NewFromUtf8(isolate, "drains", NewStringType::kNormal).ToLocalChecked(), Number::New(isolate, (double) stats->drains)).ToChecked();
+    statsObject->Set(context, String::NewFromUtf8(isolate, "maxBufferedAmount", NewStringType::kNormal).ToLocalChecked(), Integer::NewFromUnsigned(isolate, stats->maxBufferedAmount)).ToChecked();
+
+    args.GetReturnValue().Set(statsObject);
+}
+
+/* Returns RTT percentiles in milliseconds of the behaviors measuring it since the last call, undefined if there are none */
+template <typename APP>
+void uWS_App_rttStats(const FunctionCallbackInfo<Value> &args) {
+    APP *app = (APP *) getInternalPointer(args.This());//->GetAlignedPointerFromInternalField(0);
+
+    Isolate *isolate = args.GetIsolate();
+    PerContextData *perContextData = (PerContextData *) Local<External>::Cast(args.Data())->Value();
+
+    auto it = perContextData->rttHistograms.find(app);
+    if (it == perContextData->rttHistograms.end()) {
+        return;
+    }
+    LatencyHistogram *rttHistogram = it->second.get();
+
+    Local<Context> context = isolate->GetCurrentContext();
+    Local<Object> statsObject = Object::New(isolate);
+    statsObject->Set(context, String::NewFromUtf8(isolate, "count", NewStringType::kNormal).ToLocalChecked(), Number::New(isolate, (double) rttHistogram->count)).ToChecked();
+    statsObject->Set(context, String::NewFromUtf8(isolate, "min", NewStringType::kNormal).ToLocalChecked(), Number::New(isolate, (double) rttHistogram->min / 1000.0)).ToChecked();
+    statsObject->Set(context, String::NewFromUtf8(isolate, "mean", NewStringType::kNormal).ToLocalChecked(), Number::New(isolate, rttHistogram->count ? (double) rttHistogram->sum / (double) rttHistogram->count / 1000.0 : 0)).ToChecked();
+    statsObject->Set(context, String::NewFromUtf8(isolate, "p50", NewStringType::kNormal).ToLocalChecked(), Number::New(isolate, (double) rttHistogram->percentile(50) / 1000.0)).ToChecked();
+    statsObject->Set(context, String::NewFromUtf8(isolate, "p90", NewStringType::kNormal).ToLocalChecked(), Number::New(isolate, (double) rttHistogram->percentile(90) / 1000.0)).ToChecked();
+    statsObject->Set(context, String::NewFromUtf8(isolate, "p99", NewStringType::kNormal).ToLocalChecked(), Number::New(isolate, (double) rttHistogram->percentile(99) / 1000.0)).ToChecked();
+    statsObject->Set(context, String::NewFromUtf8(isolate, "p999", NewStringType::kNormal).ToLocalChecked(), Number::New(isolate, (double) rttHistogram->percentile(99.9) / 1000.0)).ToChecked();
+    statsObject->Set(context, String::NewFromUtf8(isolate, "max", NewStringType::kNormal).ToLocalChecked(), Number::New(isolate, (double) rttHistogram->max / 1000.0)).ToChecked();
+    rttHistogram->reset();
+
+    args.GetReturnValue().Set(statsObject);
+}
+
 /* This one modified per-thread static strings temporarily */
 std::pair<uWS::SocketContextOptions, bool> readOptionsObject(const FunctionCallbackInfo<Value> &args, int index) {
     Isolate *isolate = args.GetIsolate();
@@ -960,7 +1882,11 @@ void uWS_App(const FunctionCallbackInfo<Value> &args) {
                 /* This function requires perContextData */
                 PerContextData *perContextData = (PerContextData *) Local<External>::Cast(args.Data())->Value();
 
-                app->get(std::string(pattern.getString()), [cb = std::move(cb), perContextData](auto *res, auto *req) {
+                app->get(std::string(pattern.getString()), [cb = std::move(cb), perContextData, requestLimiter = getRequestLimiter(perContextData, app)](auto *res, auto *req) {
+                    if (rejectLimitedRequest<APP>(requestLimiter, res, req)) {
+                        return;
+                    }
+
                     Isolate *isolate = perContextData->isolate;
                     HandleScope hs(isolate);
 
@@ -976,6 +1902,7 @@ void uWS_App(const FunctionCallbackInfo<Value> &args) {
 
                     Local<Value> argv[] = {resObject, reqObject};
                     CallJS(isolate, cb.Get(isolate), 2, argv);
+                    passLimitedRequest<APP>(requestLimiter, res, req);
 
                     /* Properly invalidate req */
                     //reqObject->SetAlignedPointerInInternalField(0, nullptr);
@@ -1049,10 +1976,21 @@ void uWS_App(const FunctionCallbackInfo<Value> &args) {
         appTemplate->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "getDescriptor", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_App_getDescriptor<APP>, args.Data()));
         appTemplate->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "adoptSocket", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_App_adoptSocket<APP>, args.Data()));
 
+        /* Static files and in memory assets */
+        appTemplate->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "static", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_App_static<APP>, args.Data()));
+        appTemplate->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "assets", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_App_assets<APP>, args.Data()));
+        appTemplate->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "setAsset", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_App_setAsset<APP>, args.Data()));
+        appTemplate->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "removeAsset", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_App_removeAsset<APP>, args.Data()));
+
         /* ws, listen */
         appTemplate->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "ws", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_App_ws<APP>, args.Data()));
         appTemplate->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "publish", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_App_publish<APP>, args.Data()));
+        appTemplate->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "publishBatch", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_App_publishBatch<APP>, args.Data()));
         appTemplate->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "numSubscribers", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_App_numSubscribers<APP>, args.Data()));
+        appTemplate->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "numSubscribersMany", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_App_numSubscribersMany<APP>, args.Data()));
+        appTemplate->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "topicStats", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_App_topicStats<APP>, args.Data()));
+        appTemplate->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "wsStats", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_App_wsStats<APP>, args.Data()));
+        appTemplate->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "rttStats", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_App_rttStats<APP>, args.Data()));
 
         appTemplate->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "domain", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_App_domain<APP>, args.Data()));
 
@@ -1079,6 +2017,34 @@ void uWS_App(const FunctionCallbackInfo<Value> &args) {
             perContextData->apps.emplace_back(app);
         }
 
+        /* Receive publishes of other threads */
+        joinPublicationQueues(perContextData);
+
+        /* Per client address request rate limit, enforced before route handlers run, and topic stats */
+        if (args.Length() > 0 && args[0]->IsObject()) {
+            Local<Object> optionsObject = Local<Object>::Cast(args[0]);
+
+            MaybeLocal<Value> maybeMaxRequestsPerSecond = optionsObject->Get(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "maxRequestsPerSecond", NewStringType::kNormal).ToLocalChecked());
+            if (!maybeMaxRequestsPerSecond.IsEmpty() && !maybeMaxRequestsPerSecond.ToLocalChecked()->IsUndefined()) {
+                uint32_t maxRequestsPerSecond = maybeMaxRequestsPerSecond.ToLocalChecked()->Uint32Value(isolate->GetCurrentContext()).ToChecked();
+                if (maxRequestsPerSecond) {
+                    auto requestLimiter = std::make_unique<RequestLimiter>(maxRequestsPerSecond);
+                    requestLimiter->useProxiedAddress = optionsObject->Get(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "rateLimitProxiedAddress", NewStringType::kNormal).ToLocalChecked()).ToLocalChecked()->BooleanValue(isolate);
+                    perContextData->requestLimiters[app] = std::move(requestLimiter);
+
+                    /* Requests yielded to no route must not pass as counted beyond this iteration */
+                    uWS::Loop::get()->addPostHandler(&yieldedRequest, [](uWS::Loop *) {
+                        yieldedRequest = {};
+                    });
+                }
+            }
+
+            /* Publishes and bytes by topic, for topicStats */
+            if (optionsObject->Get(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "topicStats", NewStringType::kNormal).ToLocalChecked()).ToLocalChecked()->BooleanValue(isolate)) {
+                appTopicStats[app];
+            }
+        }
+
     }
 
     args.GetReturnValue().Set(localApp);
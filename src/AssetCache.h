@@ -0,0 +1,311 @@
+/*
+ * Authored by Alex Hultman, 2018-2026.
+ * Intellectual property of third-party.
+
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ADDON_ASSETCACHE_H
+#define ADDON_ASSETCACHE_H
+
+#include "App.h"
+#include "StaticFiles.h"
+
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <zlib.h>
+
+/* Small and hot files held in memory as ready responses: the body of every content coding with its headers
+ * serialized once. Serving one picks a coding from accept-encoding and writes it in two writes, headers and body.
+ * gzip is made here unless given, brotli only ever comes precompressed, as .br files or from JS */
+struct AssetCache {
+    enum Coding {
+        IDENTITY, GZIP, BROTLI, CODINGS
+    };
+
+    std::string index = "index.html";
+    /* Cache-Control of assets added from now on, none if empty */
+    std::string cacheControl;
+    uint32_t maxFileSize = 1024 * 1024;
+
+
+    struct Variant {
+        /* All headers, where the last one is split off to be written by writeHeader */
+        std::string headerKey, headerValue;
+        std::string body;
+    };
+
+    struct Asset {
+        Variant variants[CODINGS];
+        bool hasVariant[CODINGS] = {};
+        std::string etag;
+        /* Repeated on 304, as the variants keep theirs within headerKey */
+        std::string cacheControl;
+    };
+
+    /* Looked up by string_view without allocating */
+    struct Hash {
+        using is_transparent = void;
+        size_t operator()(std::string_view url) const {
+            return std::hash<std::string_view>()(url);
+        }
+    };
+
+private:
+    std::unordered_map<std::string, Asset, Hash, std::equal_to<>> assets;
+
+    /* Prefixes and exact URLs having a route serving from here */
+    std::vector<std::string> prefixes;
+    std::vector<std::string> urls;
+
+    static std::string gzip(std::string_view data) {
+        z_stream stream = {};
+        if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK) {
+            return {};
+        }
+        std::string compressed(deflateBound(&stream, (uLong) data.length()), 0);
+        stream.next_in = (Bytef *) data.data();
+        stream.avail_in = (uInt) data.length();
+        stream.next_out = (Bytef *) compressed.data();
+        stream.avail_out = (uInt) compressed.length();
+        bool finished = deflate(&stream, Z_FINISH) == Z_STREAM_END;
+        compressed.resize(finished ? compressed.length() - stream.avail_out : 0);
+        deflateEnd(&stream);
+        return compressed;
+    }
+
+    static bool equalsIgnoringCase(std::string_view a, std::string_view b) {
+        return a.length() == b.length() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+            return tolower((unsigned char) x) == tolower((unsigned char) y);
+        });
+    }
+
+    static std::string_view trim(std::string_view value) {
+        while (value.length() && (value.front() == ' ' || value.front() == '\t')) {
+            value.remove_prefix(1);
+        }
+        while (value.length() && (value.back() == ' ' || value.back() == '\t')) {
+            value.remove_suffix(1);
+        }
+        return value;
+    }
+
+    /* Whether accept-encoding accepts coding, named or by *, with a non-zero q */
+    static bool accepts(std::string_view acceptEncoding, std::string_view coding) {
+        int byWildcard = -1;
+        while (acceptEncoding.length()) {
+            size_t comma = acceptEncoding.find(',');
+            std::string_view item = acceptEncoding.substr(0, comma);
+            acceptEncoding.remove_prefix(comma == std::string_view::npos ? acceptEncoding.length() : comma + 1);
+
+            size_t semicolon = item.find(';');
+            std::string_view name = trim(item.substr(0, semicolon));
+            bool acceptable = true;
+            if (semicolon != std::string_view::npos) {
+                std::string_view parameter = trim(item.substr(semicolon + 1));
+                if (parameter.length() > 2 && (parameter[0] == 'q' || parameter[0] == 'Q') && parameter[1] == '=') {
+                    acceptable = parameter.substr(2).find_first_not_of("0.") != std::string_view::npos;
+                }
+            }
+
+            if (equalsIgnoringCase(name, coding)) {
+                return acceptable;
+            }
+            if (name == "*") {
+                byWildcard = acceptable;
+            }
+        }
+        return byWildcard == 1;
+    }
+
+    static bool readFile(const std::filesystem::path &path, std::string &data) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            return false;
+        }
+        data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        return !file.bad();
+    }
+
+public:
+    /* Returns the asset of url, or of its index if url ends with / */
+    const Asset *find(std::string_view url) const {
+        auto it = assets.find(url);
+        if (it == assets.end() && url.length() && url.back() == '/' && index.length()) {
+            it = assets.find(std::string(url) + index);
+        }
+        return it == assets.end() ? nullptr : &it->second;
+    }
+
+    /* Adds or replaces the asset of url. An empty gzip is made here if it pays off, an empty brotli means none */
+    void set(std::string_view url, std::string body, std::string_view contentType, std::string gzipBody = {}, std::string brotliBody = {}) {
+        Asset asset;
+
+        char etag[48];
+        snprintf(etag, sizeof(etag), "\"%zx-%zx\"", body.length(), std::hash<std::string_view>()(body));
+        asset.etag = etag;
+        asset.cacheControl = cacheControl;
+
+        if (gzipBody.empty()) {
+            gzipBody = gzip(body);
+        }
+        size_t length = body.length();
+        std::string bodies[CODINGS] = {std::move(body), std::move(gzipBody), std::move(brotliBody)};
+        static const std::string_view codingNames[CODINGS] = {"", "gzip", "br"};
+
+        for (int coding = IDENTITY; coding < CODINGS; coding++) {
+            /* Codings not making it smaller are not worth decoding */
+            if (coding != IDENTITY && (bodies[coding].empty() || bodies[coding].length() >= length)) {
+                continue;
+            }
+
+            std::vector<std::pair<std::string_view, std::string_view>> headers = {{"Content-Type", contentType}, {"ETag", asset.etag}, {"Vary", "Accept-Encoding"}};
+            if (cacheControl.length()) {
+                headers.emplace_back("Cache-Control", cacheControl);
+            }
+            if (coding != IDENTITY) {
+                headers.emplace_back("Content-Encoding", codingNames[coding]);
+            }
+
+            Variant &variant = asset.variants[coding];
+            for (size_t i = 0; i + 1 < headers.size(); i++) {
+                variant.headerKey.append(headers[i].first).append(": ").append(headers[i].second).append("\r\n");
+            }
+            variant.headerKey.append(headers.back().first);
+            variant.headerValue = headers.back().second;
+            variant.body = std::move(bodies[coding]);
+            asset.hasVariant[coding] = true;
+        }
+
+        auto it = assets.find(url);
+        if (it == assets.end()) {
+            assets.emplace(std::string(url), std::move(asset));
+        } else {
+            it->second = std::move(asset);
+        }
+    }
+
+    bool remove(std::string_view url) {
+        auto it = assets.find(url);
+        if (it == assets.end()) {
+            return false;
+        }
+        assets.erase(it);
+        return true;
+    }
+
+    /* Adds every file below directory of at most maxFileSize under prefix, with its .gz and .br siblings
+     * as precompressed codings. Returns the number of assets added, or -1 if directory could not be read */
+    int load(std::string_view prefix, const std::string &directory) {
+        std::error_code ec;
+        std::filesystem::recursive_directory_iterator it(directory, std::filesystem::directory_options::skip_permission_denied, ec);
+        if (ec) {
+            return -1;
+        }
+
+        int loaded = 0;
+        for (; it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+            if (ec) {
+                return -1;
+            }
+            if (!it->is_regular_file(ec) || it->file_size(ec) > maxFileSize) {
+                continue;
+            }
+
+            std::filesystem::path path = it->path();
+            std::filesystem::path extension = path.extension();
+            if ((extension == ".gz" || extension == ".br") && std::filesystem::is_regular_file(std::filesystem::path(path).replace_extension(), ec)) {
+                continue;
+            }
+
+            std::string body, gzipBody, brotliBody;
+            if (!readFile(path, body)) {
+                continue;
+            }
+            std::filesystem::path gzipPath = path, brotliPath = path;
+            if (std::filesystem::is_regular_file(gzipPath += ".gz", ec)) {
+                readFile(gzipPath, gzipBody);
+            }
+            if (std::filesystem::is_regular_file(brotliPath += ".br", ec)) {
+                readFile(brotliPath, brotliBody);
+            }
+
+            std::string relative = path.lexically_relative(directory).generic_string();
+            set(std::string(prefix) + "/" + relative, std::move(body), OpenFile::contentTypeOf(relative), std::move(gzipBody), std::move(brotliBody));
+            loaded++;
+        }
+        return loaded;
+    }
+
+    /* Returns whether prefix is new, needing a route */
+    bool addPrefix(std::string_view prefix) {
+        if (std::find(prefixes.begin(), prefixes.end(), prefix) != prefixes.end()) {
+            return false;
+        }
+        prefixes.emplace_back(prefix);
+        return true;
+    }
+
+    /* Returns whether url is neither below a prefix nor seen before, needing a route of its own */
+    bool addUrl(std::string_view url) {
+        for (std::string &prefix : prefixes) {
+            if (url.length() > prefix.length() && url.substr(0, prefix.length()) == prefix && url[prefix.length()] == '/') {
+                return false;
+            }
+        }
+        if (std::find(urls.begin(), urls.end(), url) != urls.end()) {
+            return false;
+        }
+        urls.emplace_back(url);
+        return true;
+    }
+
+    template <bool SSL>
+    static void serve(uWS::HttpResponse<SSL> *res, uWS::HttpRequest *req, const Asset *asset, bool head) {
+        std::string_view ifNoneMatch = req->getHeader("if-none-match");
+        if (ifNoneMatch.length() && (ifNoneMatch == "*" || ifNoneMatch.find(asset->etag) != std::string_view::npos)) {
+            res->writeStatus("304 Not Modified")->writeHeader("ETag", asset->etag)->writeHeader("Vary", "Accept-Encoding");
+            if (asset->cacheControl.length()) {
+                res->writeHeader("Cache-Control", asset->cacheControl);
+            }
+            res->endWithoutBody();
+            return;
+        }
+
+        Coding coding = IDENTITY;
+        std::string_view acceptEncoding = req->getHeader("accept-encoding");
+        if (acceptEncoding.length()) {
+            if (asset->hasVariant[BROTLI] && accepts(acceptEncoding, "br")) {
+                coding = BROTLI;
+            } else if (asset->hasVariant[GZIP] && accepts(acceptEncoding, "gzip")) {
+                coding = GZIP;
+            }
+        }
+
+        const Variant &variant = asset->variants[coding];
+        res->writeHeader(variant.headerKey, variant.headerValue);
+        if (head) {
+            res->endWithoutBody(variant.body.length());
+        } else {
+            res->end(variant.body);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,142 @@
+/*
+ * Authored by Alex Hultman, 2018-2026.
+ * Intellectual property of third-party.
+
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ADDON_CONFLATEDTOPICS_H
+#define ADDON_CONFLATEDTOPICS_H
+
+#include "App.h"
+#include "Utilities.h"
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/* Latest-value publishing for slow subscribers. A conflated publish to a WebSocket buffering more than its
+ * conflationWatermark is deferred, replacing the deferred message of the same topic in place, and what is
+ * deferred goes out on drain. Memory stays at one message per topic and slow subscriber */
+struct ConflatedMessage {
+    std::string topic;
+    std::string message;
+    uWS::OpCode opCode;
+    bool compress;
+};
+
+/* Deferred messages of every WebSocket, in order of first deferral */
+thread_local std::unordered_map<void *, std::vector<ConflatedMessage>> conflatedMessages;
+
+/* Bumped whenever a WebSocket closes, so that sends know the sockets they collected may be gone */
+thread_local unsigned long long closedWebSockets = 0;
+
+static inline void deferConflated(void *ws, std::string_view topic, std::string_view message, uWS::OpCode opCode, bool compress) {
+    std::vector<ConflatedMessage> &deferred = conflatedMessages[ws];
+    for (ConflatedMessage &conflatedMessage : deferred) {
+        if (conflatedMessage.topic == topic) {
+            conflatedMessage.message.assign(message);
+            conflatedMessage.opCode = opCode;
+            conflatedMessage.compress = compress;
+            return;
+        }
+    }
+    deferred.push_back({std::string(topic), std::string(message), opCode, compress});
+}
+
+/* Called when a WebSocket closes */
+static inline void dropConflated(void *ws) {
+    closedWebSockets++;
+    if (!conflatedMessages.empty()) {
+        conflatedMessages.erase(ws);
+    }
+}
+
+/* Called on drain, sends deferred messages for as long as ws stays below its watermark */
+template <bool SSL>
+static inline void flushConflated(uWS::WebSocket<SSL, true, PerSocketData> *ws) {
+    if (conflatedMessages.empty()) {
+        return;
+    }
+    auto it = conflatedMessages.find(ws);
+    if (it == conflatedMessages.end()) {
+        return;
+    }
+
+    std::vector<ConflatedMessage> deferred = std::move(it->second);
+    conflatedMessages.erase(it);
+
+    uint32_t watermark = ((PerSocketData *) ws->getUserData())->conflationWatermark;
+    size_t sent = 0;
+    while (sent < deferred.size() && ws->getBufferedAmount() <= watermark) {
+        unsigned long long closed = closedWebSockets;
+        ConflatedMessage &conflatedMessage = deferred[sent++];
+        ws->send(conflatedMessage.message, conflatedMessage.opCode, conflatedMessage.compress);
+
+        /* Sending may close ws, taking what is left with it */
+        if (closed != closedWebSockets) {
+            return;
+        }
+    }
+
+    if (sent < deferred.size()) {
+        deferred.erase(deferred.begin(), deferred.begin() + sent);
+        conflatedMessages[ws] = std::move(deferred);
+    }
+}
+
+/* Publishes to the subscribers of topic, deferring for those over their watermark. Returns whether there were any */
+template <bool SSL>
+static inline bool publishConflated(uWS::TemplatedApp<SSL> *app, std::string_view topic, std::string_view message, uWS::OpCode opCode, bool compress, void *publisher = nullptr) {
+    if (!app->topicTree) {
+        return false;
+    }
+
+    /* Regular publishes made before this one go out first */
+    app->topicTree->drain();
+
+    uWS::Topic *subscribedTopic = app->topicTree->lookupTopic(topic);
+    if (!subscribedTopic) {
+        return false;
+    }
+
+    std::vector<uWS::Subscriber *> subscribers(subscribedTopic->begin(), subscribedTopic->end());
+    unsigned long long closed = closedWebSockets;
+    for (uWS::Subscriber *subscriber : subscribers) {
+        /* Anything may have closed since, only those still subscribed are alive */
+        if (closed != closedWebSockets) {
+            subscribedTopic = app->topicTree->lookupTopic(topic);
+            if (!subscribedTopic || !subscribedTopic->count(subscriber)) {
+                continue;
+            }
+        }
+        if (subscriber->user == publisher) {
+            continue;
+        }
+
+        auto *ws = (uWS::WebSocket<SSL, true, PerSocketData> *) subscriber->user;
+        PerSocketData *perSocketData = (PerSocketData *) ws->getUserData();
+
+        /* Deferring behind already deferred messages keeps the order of topics */
+        if (ws->getBufferedAmount() > perSocketData->conflationWatermark || (!conflatedMessages.empty() && conflatedMessages.contains(ws))) {
+            deferConflated(ws, topic, message, opCode, compress);
+        } else {
+            ws->send(message, opCode, compress);
+        }
+    }
+
+    return subscribers.size();
+}
+
+#endif
@@ -1,194 +1,320 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <unistd.h>
+#ifndef ADDON_FASTTIMERS_H
+#define ADDON_FASTTIMERS_H
+
 #include <limits.h>
+#include <stdint.h>
+#include <vector>
 
-/* Free timers is a stack of available timer offsets */
-unsigned int freeTimersHead = 0;
-unsigned int freeTimers[1000000];
+/* A five level timer wheel with O(1) insert and remove. Every timer is a bunch of components,
+ * each counting boundaries of its own period, and lives in the list of its biggest remaining component.
+ * One wheel per loop, timers are strides in a slab growing with the number of live timers.
+ * Handles are the slab offset tagged with a generation bumped on every reuse, so stale handles are ignored.
+ * The generation sits above the 32 offset bits, so it never limits the number of timers.
+ * All timers expiring in one tick are handed to the callback as one batch, after all lists have been walked,
+ * so the callback may set and clear any timer. Repeating timers are rearmed once the callback returns. */
+struct FastTimers {
+    static constexpr unsigned int componentMultiplierMs[5] = {10, 50, 100, 500, 1000};
 
-/* Every timer is a bunch of components */
-unsigned int componentMultiplierMs[5] = {10, 50, 100, 500, 1000};
+    /* Handles are offset | generation << OFFSET_BITS, kept below 2^53 so that they are exact as JavaScript numbers */
+    typedef uint64_t Handle;
+    static constexpr unsigned int OFFSET_BITS = 32;
+    static constexpr Handle OFFSET_MASK = (1ull << OFFSET_BITS) - 1;
+    static constexpr unsigned int GENERATIONS = 1u << (53 - OFFSET_BITS);
 
-struct Timer {
-    /* Offsets in timers array */
-    unsigned int next, prev;
+    /* Returned by setTimeout when out of timers, generation is never 0 so this is never a handle */
+    static constexpr Handle NO_TIMER = 0;
 
-    /* The components remaining for this untriggered run */
-    unsigned int components[5];
+private:
+    struct Timer {
+        /* Offsets in timers slab, next doubles as free list link */
+        unsigned int next, prev;
 
-    /* We need to track the original Ms in case of repeat timers */
-    unsigned int nextOriginalMs;
+        /* The components remaining for this untriggered run */
+        unsigned int components[5];
 
-    /* Overshoot Ms is used to track accumulated overshoot and to remove smallest 10ms when overshot more than 10ms */
-    unsigned int overshootMs;
+        /* We need to track the original Ms in case of repeat timers */
+        unsigned int nextOriginalMs;
 
-    /* What list the timer is in */
-    unsigned int componentOffset;
-};
+        /* Set for intervals, which may well have 0 as their ms */
+        bool repeat;
+
+        /* Overshoot Ms is used to track accumulated overshoot and to remove smallest 10ms when overshot more than 10ms */
+        unsigned int overshootMs;
+
+        /* What list the timer is in, UINT_MAX if free, EXPIRED if in the batch being called back */
+        unsigned int componentOffset;
+
+        /* Bumped whenever the timer is freed, never 0 so that handle 0 is never valid */
+        unsigned int generation;
+    };
+
+    static constexpr unsigned int EXPIRED = UINT_MAX - 1;
+
+    std::vector<Timer> timers;
 
-/* Timers are strides over an integer array */
-struct Timer timers[1000000];
+    /* Free timers is a stack of available timer offsets, linked through Timer::next */
+    unsigned int freeTimersHead = UINT_MAX;
 
-/* Timer to registered callback */
-void (*timerCallbacks[1000000])();
+    /* Per component timer doubly linked list (head) */
+    unsigned int timerListHead[5] = {UINT_MAX, UINT_MAX, UINT_MAX, UINT_MAX, UINT_MAX};
 
-/* Per component timer doubly linked list (head) */
-unsigned int timerListHead[5] = {UINT_MAX, UINT_MAX, UINT_MAX, UINT_MAX, UINT_MAX};
+    /* Number of 10ms ticks since construction, components are counted on absolute boundaries of this */
+    unsigned long long tickCount = 0;
 
-void cb() {
-    printf("A timer triggered!\n");
-}
+    /* Number of timers currently set */
+    unsigned int activeTimers = 0;
 
-void init() {
-    freeTimersHead = 0;
-    for (int i = 0; i < 1000000; i++) {
-        freeTimers[i] = i;
+    /* Called once per tick with the handles of all triggered timers */
+    void (*cb)(Handle *timers, unsigned int count, void *user);
+    void *user;
+
+    /* Handles of timers triggered in the current tick */
+    std::vector<Handle> expired;
+
+    /* Returns UINT_MAX if all offsets are taken, UINT_MAX itself is the list terminator */
+    unsigned int allocateTimer() {
+        if (freeTimersHead == UINT_MAX) {
+            if (timers.size() == UINT_MAX) {
+                return UINT_MAX;
+            }
+            timers.emplace_back();
+            freeTimersHead = (unsigned int) timers.size() - 1;
+            timers[freeTimersHead].next = UINT_MAX;
+            timers[freeTimersHead].generation = 1;
+        }
+        unsigned int timer = freeTimersHead;
+        freeTimersHead = timers[timer].next;
+        activeTimers++;
+        return timer;
     }
-    for (int i = 0; i < 5; i++) {
-        timerListHead[i] = UINT_MAX;
+
+    void freeTimer(unsigned int timer) {
+        if (++timers[timer].generation == GENERATIONS) {
+            timers[timer].generation = 1;
+        }
+        timers[timer].componentOffset = UINT_MAX;
+        timers[timer].next = freeTimersHead;
+        freeTimersHead = timer;
+        activeTimers--;
     }
-}
 
-unsigned int allocateTimer() {
-    freeTimersHead++;
-    //printf("Allocating timer: %d\n", freeTimers[freeTimersHead - 1]);
-    return freeTimers[freeTimersHead - 1];
-}
+    /* The biggest component counts all its boundaries up to the expiry, the remainder is split over smaller components.
+     * Now is elapsedUs past the boundary of the current tick, which may be more than one tick when ticks are run late */
+    unsigned int divideComponents(unsigned int components[5], unsigned int *biggestSetComponent, unsigned int ms, unsigned long long elapsedUs) {
+        for (int i = 0; i < 5; i++) {
+            components[i] = 0;
+        }
 
-void freeTimer(unsigned int timer) {
-    //printf("Freeing timer: %d\n", timer);
-    freeTimersHead--;
-    freeTimers[freeTimersHead] = timer;
-}
+        /* We can only trigger on ticks, take the first boundary at least ms from now and never trigger in the current tick */
+        unsigned long long delayUs = (unsigned long long) ms * 1000 + elapsedUs;
+        unsigned long long ticks = (delayUs + 9999) / 10000;
+        if (!ticks) {
+            ticks = 1;
+        }
+        unsigned long long expiry = tickCount + ticks;
 
-unsigned int divideComponents(unsigned int components[5], unsigned int *biggestSetComponent, unsigned int ms) {
-    /* Start on fifth component */
-    int biggestComponent = 4;
+        /* Find the biggest component with a boundary until expiry (the 10ms one always has) */
+        int biggestComponent = 4;
+        while (biggestComponent && expiry / (componentMultiplierMs[biggestComponent] / 10) == tickCount / (componentMultiplierMs[biggestComponent] / 10)) {
+            biggestComponent--;
+        }
+        *biggestSetComponent = biggestComponent;
 
-    while (ms > 0 && biggestComponent >= 0) {
-        /* Can we divide by this component? */
-        if (ms >= componentMultiplierMs[biggestComponent]) {
-            components[biggestComponent] = ms / componentMultiplierMs[biggestComponent];
-            ms -= components[biggestComponent] * componentMultiplierMs[biggestComponent];
+        unsigned long long periodTicks = componentMultiplierMs[biggestComponent] / 10;
+        components[biggestComponent] = (unsigned int) (expiry / periodTicks - tickCount / periodTicks);
 
-            if (*biggestSetComponent < biggestComponent) {
-                *biggestSetComponent = biggestComponent;
-            }
+        /* What remains after the last boundary of the biggest component */
+        unsigned long long remainingTicks = expiry % periodTicks;
+        for (int i = biggestComponent - 1; i >= 0 && remainingTicks; i--) {
+            components[i] = (unsigned int) (remainingTicks / (componentMultiplierMs[i] / 10));
+            remainingTicks -= components[i] * (componentMultiplierMs[i] / 10);
         }
-        biggestComponent--;
+
+        /* Return the overshoot */
+        return (unsigned int) ((ticks * 10000 - delayUs) / 1000);
     }
 
-    unsigned int overshoot = 0;
-    if (ms) {
-        components[0]++;
-        overshoot = 10 - ms;
+    void addTimerToList(unsigned int timer, unsigned int componentOffset) {
+        unsigned int head = timerListHead[componentOffset];
+        timers[timer].next = head;
+        timers[timer].prev = UINT_MAX;
+        if (head != UINT_MAX) {
+            timers[head].prev = timer;
+        }
+        timerListHead[componentOffset] = timer;
+
+        /* Track what list the timer is in */
+        timers[timer].componentOffset = componentOffset;
+    }
+
+    /* Returns the next timer in the list or UINT_MAX */
+    unsigned int removeTimerFromList(unsigned int timer, unsigned int componentOffset) {
+        unsigned int prev = timers[timer].prev;
+        unsigned int next = timers[timer].next;
+
+        if (prev != UINT_MAX) {
+            timers[prev].next = next;
+        } else {
+            timerListHead[componentOffset] = next;
+        }
+
+        if (next != UINT_MAX) {
+            timers[next].prev = prev;
+        }
+
+        return next;
     }
 
-    /* Return the overshoot */
-    return overshoot;
-}
+    unsigned int moveTimerToList(unsigned int timer, unsigned int newComponentOffset) {
+        unsigned int currentComponentOffset = timers[timer].componentOffset;
+        unsigned int nextTimer = removeTimerFromList(timer, currentComponentOffset);
+        addTimerToList(timer, newComponentOffset);
+        return nextTimer;
+    }
 
-void addTimerToList(unsigned int timer, unsigned int componentOffset) {
-    unsigned int head = timerListHead[componentOffset];
-    timers[timer].next = head;
-    timers[timer].prev = UINT_MAX;
-    if (head != UINT_MAX) {
-        timers[head].prev = timer;
+    /* Trigger a tick of the given component offset */
+    void tick(unsigned int componentOffset) {
+        /* Iterate this list, decrementing the timer components */
+        unsigned int timerIterator = timerListHead[componentOffset];
+
+        while (timerIterator != UINT_MAX) {
+            /* This timer needs to move to a higher precision list, or trigger */
+            if (!--timers[timerIterator].components[componentOffset]) {
+
+                /* Seek to next non-null component or the 0th component */
+                unsigned int nextComponentOffsetForTimer = componentOffset;
+                while (nextComponentOffsetForTimer && timers[timerIterator].components[nextComponentOffsetForTimer] == 0) {
+                    nextComponentOffsetForTimer--;
+                }
+
+                /* Here we either have a new list to join or we trigger the timer here and now */
+                if (timers[timerIterator].components[nextComponentOffsetForTimer]) {
+                    /* This should return the next timerIterator */
+                    timerIterator = moveTimerToList(timerIterator, nextComponentOffsetForTimer);
+                } else {
+                    /* Unlink and mark the timer, it is called back when all lists have been walked */
+                    unsigned int timer = timerIterator;
+                    timerIterator = removeTimerFromList(timer, componentOffset);
+                    timers[timer].componentOffset = EXPIRED;
+                    expired.push_back(handleOf(timer));
+                }
+            } else {
+                timerIterator = timers[timerIterator].next;
+            }
+        }
     }
-    timerListHead[componentOffset] = timer;
 
-    /* Track what list the timer is in */
-    timers[timer].componentOffset = componentOffset;
-}
+public:
+    FastTimers(void (*cb)(Handle *timers, unsigned int count, void *user), void *user) : cb(cb), user(user) {
 
-/* Returns the next timer in the list or UINT_MAX */
-unsigned int removeTimerFromList(unsigned int timer, unsigned int componentOffset) {
-    unsigned int prev = timers[timer].prev;
-    unsigned int next = timers[timer].next;
+    }
 
-    if (prev != UINT_MAX) {
-        timers[prev].next = next;
-    } else {
-        timerListHead[componentOffset] = next;
+    unsigned int getActiveTimers() {
+        return activeTimers;
     }
 
-    if (next != UINT_MAX) {
-        timers[next].prev = prev;
+    /* Returns one past the biggest timer offset handed out so far */
+    unsigned int getCapacity() {
+        return (unsigned int) timers.size();
     }
 
-    return next;
-}
+    /* The slab offset of a handle, for keeping state per timer */
+    static unsigned int offsetOf(Handle handle) {
+        return (unsigned int) (handle & OFFSET_MASK);
+    }
 
-unsigned int moveTimerToList(unsigned int timer, unsigned int newComponentOffset) {
-    unsigned int currentComponentOffset = timers[timer].componentOffset;
-    unsigned int nextTimer = removeTimerFromList(timer, currentComponentOffset);
-    addTimerToList(timer, newComponentOffset);
-    return nextTimer;
-}
+    Handle handleOf(unsigned int timer) {
+        return timer | (Handle) timers[timer].generation << OFFSET_BITS;
+    }
 
-/* Trigger a tick of the given component offset, to be called from system timers */
-void tick(unsigned int componentOffset) {
-    //printf("Tick for %d\n", componentOffset);
+    /* Whether the handle is of a timer that is set (or being called back), false for stale handles */
+    bool isSet(Handle handle) {
+        unsigned int timer = offsetOf(handle);
+        return timer < timers.size() && timers[timer].componentOffset != UINT_MAX && timers[timer].generation == handle >> OFFSET_BITS;
+    }
 
-    /* Iterate this list, decrementing the timer components */
-    unsigned int timerIterator = timerListHead[componentOffset];
+    /* Whether a timer of the batch being called back is still to be handled (was not cleared) */
+    bool isExpired(Handle handle) {
+        return isSet(handle) && timers[offsetOf(handle)].componentOffset == EXPIRED;
+    }
 
-    while (timerIterator != UINT_MAX) {
-        //printf("Iterating timer %d\n", timerIterator);
+    bool isRepeating(Handle handle) {
+        return timers[offsetOf(handle)].repeat;
+    }
 
-        /* This timer needs to move to a higher precision list, or trigger */
-        if (!--timers[timerIterator].components[componentOffset]) {
-            
-            /* Seek to next non-null component or the 0th component */
-            unsigned int nextComponentOffsetForTimer = componentOffset;
-            while (nextComponentOffsetForTimer && timers[timerIterator].components[nextComponentOffsetForTimer] == 0) {
-                nextComponentOffsetForTimer--;
+    /* Advances one 10ms tick, to be called from a system timer every 10ms. Smaller components
+     * tick first so that timers moving down to them are not counted on the same boundary twice */
+    void advance() {
+        tickCount++;
+        for (unsigned int componentOffset = 0; componentOffset < 5; componentOffset++) {
+            if (tickCount % (componentMultiplierMs[componentOffset] / 10) == 0) {
+                tick(componentOffset);
             }
+        }
 
-            /* Here we either have a new list to join or we trigger the timer here and now */
-            if (timers[timerIterator].components[nextComponentOffsetForTimer]) {
-                /* This should return the next timerIterator */
-                timerIterator = moveTimerToList(timerIterator, nextComponentOffsetForTimer);
-            } else {
-                /* This callback must not modify the list (but we can handle that later!) */
-                timerCallbacks[timerIterator]();
+        if (expired.empty()) {
+            return;
+        }
 
-                /* If the timer itself is removed in the above callback, below removal will fail */
+        /* The callback may clear (and reuse) any of these, and set new timers, but never re-enters advance */
+        cb(expired.data(), (unsigned int) expired.size(), user);
 
-                /* And remove the timer (this should return the next timerIterator) */
-                timerIterator = removeTimerFromList(timerIterator, componentOffset);
+        for (Handle handle : expired) {
+            if (!isExpired(handle)) {
+                continue;
+            }
+
+            unsigned int timer = offsetOf(handle);
+            if (timers[timer].repeat) {
+                /* Take off what we overshot so far, so that intervals do not drift */
+                unsigned int ms = timers[timer].nextOriginalMs > timers[timer].overshootMs ? timers[timer].nextOriginalMs - timers[timer].overshootMs : 0;
+                unsigned int biggestSetComponent = 0;
+                timers[timer].overshootMs = divideComponents(timers[timer].components, &biggestSetComponent, ms, 0);
+                addTimerToList(timer, biggestSetComponent);
+            } else {
+                freeTimer(timer);
             }
-        } else {
-            timerIterator = timers[timerIterator].next;
         }
+        expired.clear();
     }
-}
 
-unsigned int setTimeout_(void (*cb)(), unsigned int ms) {
-    /* Allocate free timer */
-    unsigned int timer = allocateTimer();
-    
-    /* Divide given ms in components */
-    unsigned int biggestSetComponent = 0;
-    timers[timer].overshootMs = divideComponents(timers[timer].components, &biggestSetComponent, ms);
+    /* Repeating timers trigger every ms until cleared. Never triggers before ms have passed,
+     * given how far past the boundary of the current tick we are. Returns a handle, or NO_TIMER if out of timers */
+    Handle setTimeout(unsigned int ms, bool repeat = false, unsigned long long elapsedUs = 0) {
+        /* Allocate free timer */
+        unsigned int timer = allocateTimer();
+        if (timer == UINT_MAX) {
+            return NO_TIMER;
+        }
 
-    //printf("Overshoot by %u ms\n", timers[timer].overshootMs);
-    //printf("Biggest set component is %u\n", biggestSetComponent);
+        /* Divide given ms in components */
+        unsigned int biggestSetComponent = 0;
+        timers[timer].overshootMs = divideComponents(timers[timer].components, &biggestSetComponent, ms, elapsedUs);
+        timers[timer].nextOriginalMs = ms;
+        timers[timer].repeat = repeat;
 
-    /* Add the timer to the list of the highest component */
-    addTimerToList(timer, biggestSetComponent);
+        /* Add the timer to the list of the highest component */
+        addTimerToList(timer, biggestSetComponent);
 
-    /* Set the callback */
-    timerCallbacks[timer] = cb;
+        return handleOf(timer);
+    }
+
+    /* May be called from within the callback, for any timer. Returns false for stale handles, which are left alone */
+    bool clearTimeout(Handle handle) {
+        if (!isSet(handle)) {
+            return false;
+        }
+        unsigned int timer = offsetOf(handle);
 
-    return timer;
-}
+        /* Unlink the timer from its list, unless it is in the batch being called back */
+        if (timers[timer].componentOffset != EXPIRED) {
+            removeTimerFromList(timer, timers[timer].componentOffset);
+        }
 
-void clearTimeout_(unsigned int timer) {
-    /* Unlink the timer from its list */
-    removeTimerFromList(timer, timers[timer].componentOffset);
+        /* Put the timer back on the free stack */
+        freeTimer(timer);
+        return true;
+    }
+};
 
-    /* Put the timer into free timer circle buffer */
-    freeTimer(timer);
-}
\ No newline at end of file
+#endif
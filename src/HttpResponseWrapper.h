@@ -17,6 +17,8 @@
 
 #include "App.h"
 #include "Utilities.h"
+#include "TimersWrapper.h"
+#include "StaticFiles.h"
 
 #include <v8.h>
 using namespace v8;
@@ -27,6 +29,9 @@ thread_local int insideCorkCallback = 0;
 
 struct HttpResponseWrapper {
 
+    /* Holds res once an abort handler is attached, clones of the template start out with nullptr */
+    static constexpr int ABORT_HANDLER_FIELD = 1;
+
     static void assumeCorked() {
         if (!insideCorkCallback) {
             std::cerr << "Warning: uWS.HttpResponse writes must be made from within a corked callback. See documentation for uWS.HttpResponse.cork and consult the user manual." << std::endl;
@@ -53,6 +58,8 @@ struct HttpResponseWrapper {
 
     /* Marks this JS object invalid */
     static inline void invalidateResObject(const FunctionCallbackInfo<Value> &args) {
+        /* Timers of this response die with it */
+        clearSocketTimers(getInternalPointer(args.This()));
         //args.This()->SetAlignedPointerInInternalField(0, nullptr);
         setInternalPointer(args.This(), nullptr);
     }
@@ -228,11 +235,15 @@ struct HttpResponseWrapper {
             /* This is how we capture res (C++ this in invocation of this function) */
             UniquePersistent<Object> resObject(isolate, args.This());
 
-            res->onAborted([p = std::move(p), resObject = std::move(resObject), isolate]() {
+            /* Timers may only be set on responses that learn about their abort */
+            setInternalPointer(args.This(), res, ABORT_HANDLER_FIELD);
+
+            res->onAborted([p = std::move(p), resObject = std::move(resObject), isolate, res]() {
                 HandleScope hs(isolate);
 
                 /* Mark this resObject invalid */
                 setInternalPointer(Local<Object>::New(isolate, resObject), nullptr);//->SetAlignedPointerInInternalField(0, nullptr);
+                clearSocketTimers(res);
 
                 CallJS(isolate, Local<Function>::New(isolate, p), 0, nullptr);
             });
@@ -241,6 +252,43 @@ struct HttpResponseWrapper {
         }
     }
 
+    /* Takes ms, function of res and optional repeat, returns timer. The timer is cleared when the response
+     * is ended, upgraded, closed or aborted. Aborts are only seen through onAborted, so that is required first */
+    template <int SSL>
+    static void res_setTimer(const FunctionCallbackInfo<Value> &args) {
+        Isolate *isolate = args.GetIsolate();
+        auto *res = getHttpResponse<SSL>(args);
+        if (res) {
+            if (missingArguments(2, args)) {
+                return;
+            }
+
+            if (getInternalPointer(args.This(), ABORT_HANDLER_FIELD) != res) {
+                args.GetReturnValue().Set(isolate->ThrowException(v8::Exception::Error(String::NewFromUtf8(isolate, "uWS.HttpResponse.setTimer requires uWS.HttpResponse.onAborted to be attached first.", NewStringType::kNormal).ToLocalChecked())));
+                return;
+            }
+
+            uint32_t ms;
+            if (!getTimerMs(args, 0, &ms)) {
+                return;
+            }
+
+            Callback checkedCallback(isolate, args[1]);
+            if (checkedCallback.isInvalid(args)) {
+                return;
+            }
+
+            bool repeat = args[2]->BooleanValue(isolate);
+
+            FastTimers::Handle timer = setSocketTimer(isolate, res, args.This(), ms, repeat, checkedCallback.getFunction());
+            if (timer == FastTimers::NO_TIMER) {
+                args.GetReturnValue().Set(isolate->ThrowException(v8::Exception::Error(String::NewFromUtf8(isolate, "Too many timers.", NewStringType::kNormal).ToLocalChecked())));
+                return;
+            }
+            args.GetReturnValue().Set(Number::New(isolate, (double) timer));
+        }
+    }
+
     /* Takes nothing, returns arraybuffer */
     template <int SSL>
     static void res_getRemoteAddress(const FunctionCallbackInfo<Value> &args) {
@@ -462,6 +510,142 @@ struct HttpResponseWrapper {
         }
     }
 
+    /* A file sent by sendFile, held by its handlers until sent or aborted */
+    struct FileTransfer {
+        void *res;
+        std::shared_ptr<OpenFile> file;
+        uint64_t start, length, bodyStart, totalSize;
+        UniquePersistent<Object> resObject;
+        UniquePersistent<Function> cb;
+        bool ended = false;
+    };
+
+    /* Calls back once with whether the file was sent, res being invalid unless sent and left open */
+    template <int SSL>
+    static void endFileTransfer(Isolate *isolate, std::shared_ptr<FileTransfer> fileTransfer, bool sent) {
+        if (fileTransfer->ended) {
+            return;
+        }
+        fileTransfer->ended = true;
+
+        HandleScope hs(isolate);
+        auto *res = (uWS::HttpResponse<SSL != 0> *) fileTransfer->res;
+
+        if (!sent || fileTransfer->bodyStart + fileTransfer->length == fileTransfer->totalSize) {
+            clearSocketTimers(res);
+            setInternalPointer(Local<Object>::New(isolate, fileTransfer->resObject), nullptr);
+        } else {
+            /* Left open for JS to go on, which should attach its own handlers again */
+            res->onWritable([](uintmax_t) {
+                return true;
+            });
+            res->onAborted([resObject = std::move(fileTransfer->resObject), isolate, res]() {
+                HandleScope hs(isolate);
+                setInternalPointer(Local<Object>::New(isolate, resObject), nullptr);
+                clearSocketTimers(res);
+            });
+        }
+
+        if (!fileTransfer->cb.IsEmpty()) {
+            Local<Value> argv[] = {Boolean::New(isolate, sent)};
+            CallJS(isolate, Local<Function>::New(isolate, fileTransfer->cb), 1, argv);
+        }
+    }
+
+    template <int SSL>
+    static bool pumpFileTransfer(Isolate *isolate, std::shared_ptr<FileTransfer> fileTransfer) {
+        auto *res = (uWS::HttpResponse<SSL != 0> *) fileTransfer->res;
+        switch (pumpFile(res, fileTransfer->file.get(), fileTransfer->start, fileTransfer->length, fileTransfer->bodyStart, fileTransfer->totalSize)) {
+        case FilePump::SENT:
+            endFileTransfer<SSL>(isolate, fileTransfer, true);
+            return true;
+        case FilePump::FAILED:
+            /* Calls back as aborted */
+            res->close();
+            return false;
+        default:
+            return false;
+        }
+    }
+
+    /* Takes fd or path, offset, length, optional totalSize and callback of whether the file was sent. Sends length bytes of the file
+     * from offset as the body of res natively, resuming on writable, and calls back once sent or aborted. Takes over onWritable and onAborted */
+    template <int SSL>
+    static void res_sendFile(const FunctionCallbackInfo<Value> &args) {
+        Isolate *isolate = args.GetIsolate();
+        auto *res = getHttpResponse<SSL>(args);
+        if (res) {
+            if (missingArguments(3, args)) {
+                return;
+            }
+
+            /* Offset, length and totalSize are taken as uint64_t, so anything else would wrap */
+            bool hasTotalSize = args.Length() > 3 && !args[3]->IsUndefined();
+            for (int i = 1; i < (hasTotalSize ? 4 : 3); i++) {
+                if (!args[i]->IsNumber() || !(args[i]->NumberValue(isolate->GetCurrentContext()).ToChecked() >= 0)) {
+                    args.GetReturnValue().Set(isolate->ThrowException(v8::Exception::Error(String::NewFromUtf8(isolate, "sendFile offset, length and totalSize must be non-negative numbers.", NewStringType::kNormal).ToLocalChecked())));
+                    return;
+                }
+            }
+
+            /* Given descriptors stay with the caller, who may close them right away */
+            std::shared_ptr<OpenFile> file;
+            if (args[0]->IsNumber()) {
+                file = OpenFile::duplicate(args[0]->Int32Value(isolate->GetCurrentContext()).ToChecked());
+            } else {
+                NativeString path(isolate, args[0]);
+                if (path.isInvalid(args)) {
+                    return;
+                }
+                file = OpenFile::open(std::string(path.getString()));
+            }
+            if (!file) {
+                args.GetReturnValue().Set(isolate->ThrowException(v8::Exception::Error(String::NewFromUtf8(isolate, "sendFile could not open the file.", NewStringType::kNormal).ToLocalChecked())));
+                return;
+            }
+
+            std::shared_ptr<FileTransfer> fileTransfer = std::make_shared<FileTransfer>();
+            fileTransfer->res = res;
+            fileTransfer->file = std::move(file);
+            fileTransfer->start = (uint64_t) args[1]->IntegerValue(isolate->GetCurrentContext()).ToChecked();
+            fileTransfer->length = (uint64_t) args[2]->IntegerValue(isolate->GetCurrentContext()).ToChecked();
+            if (fileTransfer->start > fileTransfer->file->size || fileTransfer->length > fileTransfer->file->size - fileTransfer->start) {
+                args.GetReturnValue().Set(isolate->ThrowException(v8::Exception::Error(String::NewFromUtf8(isolate, "sendFile offset and length go past the end of the file.", NewStringType::kNormal).ToLocalChecked())));
+                return;
+            }
+            fileTransfer->bodyStart = res->getWriteOffset();
+            fileTransfer->totalSize = fileTransfer->bodyStart + fileTransfer->length;
+            if (hasTotalSize) {
+                fileTransfer->totalSize = (uint64_t) args[3]->IntegerValue(isolate->GetCurrentContext()).ToChecked();
+            }
+            if (fileTransfer->bodyStart + fileTransfer->length > fileTransfer->totalSize) {
+                args.GetReturnValue().Set(isolate->ThrowException(v8::Exception::Error(String::NewFromUtf8(isolate, "sendFile length goes past totalSize.", NewStringType::kNormal).ToLocalChecked())));
+                return;
+            }
+            if (args.Length() > 4 && !args[4]->IsUndefined()) {
+                Callback checkedCallback(isolate, args[4]);
+                if (checkedCallback.isInvalid(args)) {
+                    return;
+                }
+                fileTransfer->cb = checkedCallback.getFunction();
+            }
+            fileTransfer->resObject.Reset(isolate, args.This());
+
+            res->onWritable([fileTransfer, isolate](uintmax_t) {
+                return pumpFileTransfer<SSL>(isolate, fileTransfer);
+            });
+            res->onAborted([fileTransfer, isolate]() {
+                endFileTransfer<SSL>(isolate, fileTransfer, false);
+            });
+            setInternalPointer(args.This(), res, ABORT_HANDLER_FIELD);
+
+            assumeCorked();
+            pumpFileTransfer<SSL>(isolate, fileTransfer);
+
+            args.GetReturnValue().Set(args.This());
+        }
+    }
+
     /* Takes data, returns true for success, false for backpressure */
     template <int PROTOCOL>
     static void res_write(const FunctionCallbackInfo<Value> &args) {
@@ -591,7 +775,7 @@ struct HttpResponseWrapper {
         } else if (SSL == 3) {
             resTemplateLocal->SetClassName(String::NewFromUtf8(isolate, "uWS.CachedHttpResponse", NewStringType::kNormal).ToLocalChecked());
         }
-        resTemplateLocal->InstanceTemplate()->SetInternalFieldCount(1);
+        resTemplateLocal->InstanceTemplate()->SetInternalFieldCount(2);
 
         /* Register our functions */
         resTemplateLocal->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "end", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, res_end<SSL>));
@@ -607,12 +791,14 @@ struct HttpResponseWrapper {
             resTemplateLocal->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "onWritable", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, res_onWritable<SSL>));
             resTemplateLocal->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "onAborted", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, res_onAborted<SSL>));
             resTemplateLocal->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "onData", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, res_onData<SSL>));
+            resTemplateLocal->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "setTimer", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, res_setTimer<SSL>));
             
             /* QUIC has a lot of functions unimplemented */
             if constexpr (SSL != 2) {
                 resTemplateLocal->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "onDataV2", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, res_onDataV2<SSL>));
                 resTemplateLocal->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "collectBody", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, res_collectBody<SSL>));
                 resTemplateLocal->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "getWriteOffset", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, res_getWriteOffset<SSL>));
+                resTemplateLocal->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "sendFile", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, res_sendFile<SSL>));
                 resTemplateLocal->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "beginWrite", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, res_beginWrite<SSL>));
                 resTemplateLocal->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "getRemoteAddress", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, res_getRemoteAddress<SSL>));
                 resTemplateLocal->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "cork", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, res_cork<SSL>));
@@ -634,6 +820,7 @@ struct HttpResponseWrapper {
         
         /* Create our template */
         Local<Object> resObjectLocal = resTemplateLocal->GetFunction(isolate->GetCurrentContext()).ToLocalChecked()->NewInstance(isolate->GetCurrentContext()).ToLocalChecked();
+        setInternalPointer(resObjectLocal, nullptr, ABORT_HANDLER_FIELD);
 
         return resObjectLocal;
     }
@@ -0,0 +1,129 @@
+/*
+ * Authored by Alex Hultman, 2018-2026.
+ * Intellectual property of third-party.
+
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ADDON_LATENCYHISTOGRAM_H
+#define ADDON_LATENCYHISTOGRAM_H
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+/* Log-linear latency histogram of microseconds in the manner of HDR histograms, in fixed memory. Values below 32
+ * are exact and every power of two above is split in 16 linear buckets, keeping any percentile within 1/16 */
+struct LatencyHistogram {
+private:
+    static constexpr unsigned int SUB_BUCKETS = 16;
+    /* Values are clamped to about 18 hours */
+    static constexpr unsigned int MAX_BIT = 35;
+    static constexpr unsigned int BUCKETS = 2 * SUB_BUCKETS + (MAX_BIT - 4) * SUB_BUCKETS;
+
+    uint64_t counts[BUCKETS] = {};
+
+    static unsigned int indexOf(uint64_t value) {
+        if (value < 2 * SUB_BUCKETS) {
+            return (unsigned int) value;
+        }
+        unsigned int msb = (unsigned int) std::bit_width(value) - 1;
+        return 2 * SUB_BUCKETS + (msb - 5) * SUB_BUCKETS + (unsigned int) (value >> (msb - 4)) - SUB_BUCKETS;
+    }
+
+    /* The middle of the bucket */
+    static uint64_t valueOf(unsigned int index) {
+        if (index < 2 * SUB_BUCKETS) {
+            return index;
+        }
+        unsigned int msb = 5 + (index - 2 * SUB_BUCKETS) / SUB_BUCKETS;
+        uint64_t subBucket = SUB_BUCKETS + (index - 2 * SUB_BUCKETS) % SUB_BUCKETS;
+        return (subBucket << (msb - 4)) + ((uint64_t) 1 << (msb - 5));
+    }
+
+public:
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t min = 0, max = 0;
+
+    void record(uint64_t value) {
+        value = std::min<uint64_t>(value, ((uint64_t) 1 << (MAX_BIT + 1)) - 1);
+        counts[indexOf(value)]++;
+        min = count ? std::min(min, value) : value;
+        max = std::max(max, value);
+        count++;
+        sum += value;
+    }
+
+    /* Returns the value below which percentile of all values fall, 0 if empty */
+    uint64_t percentile(double percentile) const {
+        uint64_t rank = (uint64_t) (percentile / 100.0 * (double) count + 0.5);
+        rank = std::max<uint64_t>(rank, 1);
+        uint64_t seen = 0;
+        for (unsigned int i = 0; i < BUCKETS; i++) {
+            seen += counts[i];
+            if (seen >= rank) {
+                return std::clamp(valueOf(i), min, max);
+            }
+        }
+        return max;
+    }
+
+    void reset() {
+        *this = {};
+    }
+};
+
+/* Pings measuring RTT carry their send time, which the peer echoes back in the pong. Only the pong echoing
+ * the outstanding probe of a WebSocket counts, so peers cannot make up samples */
+struct RttProbe {
+    static constexpr std::string_view MARKER = "rtt:";
+    static constexpr size_t LENGTH = 4 + sizeof(uint64_t);
+
+    /* Probes of one WebSocket are at least this far apart, however often it pongs */
+    static constexpr uint64_t INTERVAL_US = 1000000;
+
+    static uint64_t nowUs() {
+        return (uint64_t) std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /* Writes a probe sent now, setting sentUs to its send time */
+    static std::string_view write(char (&payload)[LENGTH], uint64_t &sentUs) {
+        sentUs = nowUs();
+        memcpy(payload, MARKER.data(), MARKER.length());
+        memcpy(payload + MARKER.length(), &sentUs, sizeof(sentUs));
+        return {payload, LENGTH};
+    }
+
+    /* Whether pong carries a probe, answering ours or not */
+    static bool isProbe(std::string_view pong) {
+        return pong.length() == LENGTH && pong.substr(0, MARKER.length()) == MARKER;
+    }
+
+    /* Returns whether the probe in pong is the one sent at sentUs, and its RTT in microseconds if so */
+    static bool read(std::string_view pong, uint64_t sentUs, uint64_t &rttUs) {
+        uint64_t echoed;
+        memcpy(&echoed, pong.data() + MARKER.length(), sizeof(echoed));
+        if (echoed != sentUs) {
+            return false;
+        }
+        uint64_t now = nowUs();
+        rttUs = now > sentUs ? now - sentUs : 0;
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,101 @@
+/*
+ * Authored by Alex Hultman, 2018-2026.
+ * Intellectual property of third-party.
+
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ADDON_LOOPQUEUE_H
+#define ADDON_LOOPQUEUE_H
+
+#include "App.h"
+
+#include <atomic>
+#include <functional>
+#include <vector>
+
+/* Lock-free multi-producer, single-consumer queue owned by one uWS loop.
+ * Any thread may push. Only the push that finds the queue empty wakes the owning loop
+ * (Loop::defer), so a burst of pushes costs one wakeup and is handed over as one batch.
+ * The queue must outlive its loop; pending deferred drains are dropped when the loop is freed. */
+template <class T>
+struct LoopQueue {
+private:
+    struct Node {
+        Node *next;
+        T value;
+    };
+
+    std::atomic<Node *> head = nullptr;
+    uWS::Loop *loop;
+    std::function<void(std::vector<T> &)> handler;
+
+public:
+    LoopQueue(uWS::Loop *loop, std::function<void(std::vector<T> &)> &&handler) : loop(loop), handler(std::move(handler)) {
+
+    }
+
+    ~LoopQueue() {
+        Node *node = head.exchange(nullptr);
+        while (node) {
+            Node *next = node->next;
+            delete node;
+            node = next;
+        }
+    }
+
+    /* Thread safe, never blocks (other than for the wakeup itself) */
+    void push(T &&value) {
+        Node *node = new Node{nullptr, std::move(value)};
+        Node *previous = head.load(std::memory_order_relaxed);
+        do {
+            node->next = previous;
+        } while (!head.compare_exchange_weak(previous, node, std::memory_order_release, std::memory_order_relaxed));
+
+        /* Only the transition from empty needs to wake the loop */
+        if (!previous) {
+            loop->defer([this]() {
+                drain();
+            });
+        }
+    }
+
+    /* Must only be called on the owning loop's thread */
+    void drain() {
+        Node *node = head.exchange(nullptr, std::memory_order_acquire);
+        if (!node) {
+            return;
+        }
+
+        /* We popped a LIFO stack; reverse it to get push order */
+        Node *reversed = nullptr;
+        while (node) {
+            Node *next = node->next;
+            node->next = reversed;
+            reversed = node;
+            node = next;
+        }
+
+        std::vector<T> batch;
+        while (reversed) {
+            Node *next = reversed->next;
+            batch.emplace_back(std::move(reversed->value));
+            delete reversed;
+            reversed = next;
+        }
+
+        handler(batch);
+    }
+};
+
+#endif
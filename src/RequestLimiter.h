@@ -0,0 +1,103 @@
+/*
+ * Authored by Alex Hultman, 2018-2026.
+ * Intellectual property of third-party.
+
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ADDON_REQUESTLIMITER_H
+#define ADDON_REQUESTLIMITER_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+/* Per client address request rate limit in fixed memory. Addresses are hashed into a 4-way set associative
+ * table of sliding window counters, where a new address evicts the least recently counted one of its set.
+ * Evicted addresses start over with a fresh counter, so a flood of distinct addresses fails open rather than
+ * blocking well behaved clients. */
+struct RequestLimiter {
+private:
+    static constexpr unsigned int WAYS = 4;
+
+    struct Entry {
+        /* Upper hash bits of the address, 0 if unused */
+        uint32_t fingerprint;
+        /* The second counted in, and the counts of it and the one before */
+        uint32_t window;
+        uint32_t previousCount;
+        uint32_t count;
+    };
+
+    std::vector<Entry> entries;
+    uint32_t setMask;
+    uint32_t maxRequestsPerSecond;
+
+public:
+    /* Whether to key on the address given by the PROXY protocol rather than the peer address */
+    bool useProxiedAddress = false;
+
+    /* Sets is rounded down to a power of two */
+    RequestLimiter(uint32_t maxRequestsPerSecond, uint32_t sets = 16384) : maxRequestsPerSecond(maxRequestsPerSecond) {
+        while (sets & (sets - 1)) {
+            sets &= sets - 1;
+        }
+        entries.resize(sets * WAYS, Entry{});
+        setMask = sets - 1;
+    }
+
+    /* Counts a request from address, returns false if it is over the limit */
+    bool allow(std::string_view address) {
+        uint64_t nowMs = (uint64_t) std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        uint32_t window = (uint32_t) (nowMs / 1000);
+
+        uint64_t hash = std::hash<std::string_view>()(address);
+        uint32_t fingerprint = (uint32_t) (hash >> 32) | 1;
+        Entry *set = &entries[(hash & setMask) * WAYS];
+
+        /* Find the address, or evict the least recently counted entry */
+        Entry *entry = set;
+        for (unsigned int i = 0; i < WAYS; i++) {
+            if (set[i].fingerprint == fingerprint) {
+                entry = &set[i];
+                break;
+            }
+            if (set[i].window < entry->window) {
+                entry = &set[i];
+            }
+        }
+        if (entry->fingerprint != fingerprint) {
+            *entry = {fingerprint, window, 0, 0};
+        }
+
+        /* Roll the window */
+        if (entry->window != window) {
+            entry->previousCount = (window - entry->window == 1) ? entry->count : 0;
+            entry->count = 0;
+            entry->window = window;
+        }
+
+        /* The previous second weighs in by how much of it still overlaps the last second */
+        float previousWeight = 1.0f - (float) (nowMs % 1000) / 1000.0f;
+        if ((float) entry->previousCount * previousWeight + (float) entry->count >= (float) maxRequestsPerSecond) {
+            return false;
+        }
+
+        entry->count++;
+        return true;
+    }
+};
+
+#endif
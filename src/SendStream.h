@@ -0,0 +1,359 @@
+/*
+ * Authored by Alex Hultman, 2018-2026.
+ * Intellectual property of third-party.
+
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ADDON_SENDSTREAM_H
+#define ADDON_SENDSTREAM_H
+
+#include "App.h"
+#include "Utilities.h"
+#include "ConflatedTopics.h"
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <v8.h>
+using namespace v8;
+
+/* A send or publish to a WebSocket made while it streams */
+struct QueuedMessage {
+    std::string message;
+    uWS::OpCode opCode;
+    bool compress;
+};
+
+/* A large message sent as fragments, never buffering much more than watermark. Sending resumes on drain,
+ * so memory stays at about one fragment per WebSocket no matter the size of the message.
+ * No other data frame may go out between fragments (RFC 6455 5.4), so other sends and publishes to the
+ * WebSocket are queued until the last fragment, and its exact topics are taken from µWS meanwhile */
+struct SendStream {
+    /* ArrayBuffer source, kept alive even if detached or collected */
+    std::shared_ptr<BackingStore> backingStore;
+    const char *data = nullptr;
+
+    /* File descriptor source, read as we go */
+    int fd = -1;
+
+    /* Length and position of ArrayBuffer and file descriptor sources */
+    uint64_t offset = 0, length = 0;
+
+    /* Pull source, called with the max length of the chunk to return. An empty chunk ends it */
+    UniquePersistent<Function> pull;
+    /* Pulled one chunk ahead, to know which one is last */
+    std::string chunk, nextChunk;
+    bool pulledLast = false;
+
+    /* Called with whether the whole message was sent */
+    UniquePersistent<Function> cb;
+
+    uint32_t fragmentSize;
+    uint32_t watermark;
+    uWS::OpCode opCode;
+    bool compress;
+    bool started = false;
+
+    /* Set once the last fragment is out, or the source failed before the first. What was queued goes out next */
+    bool ending = false;
+    bool completed = false;
+
+    /* Sends and publishes made meanwhile, at most maxBackpressure bytes of them (0 if unlimited) */
+    std::deque<QueuedMessage> queue;
+    size_t queuedBytes = 0;
+    uint32_t maxBackpressure = 0;
+
+    /* Exact topics taken from the topic tree of the app, given back when ending */
+    void *app = nullptr;
+    std::vector<std::string> topics;
+};
+
+/* Streams of every WebSocket, at most one each */
+thread_local std::unordered_map<void *, SendStream> sendStreams;
+
+/* Returns the stream of ws, if it has one */
+static inline SendStream *getSendStream(void *ws) {
+    if (sendStreams.empty()) {
+        return nullptr;
+    }
+    auto it = sendStreams.find(ws);
+    return it == sendStreams.end() ? nullptr : &it->second;
+}
+
+/* Returns false if queueing would go past maxBackpressure */
+static inline bool queueBehindSendStream(SendStream &sendStream, std::string_view message, uWS::OpCode opCode, bool compress) {
+    if (sendStream.maxBackpressure && sendStream.queuedBytes + message.length() > sendStream.maxBackpressure) {
+        return false;
+    }
+    sendStream.queue.push_back({std::string(message), opCode, compress});
+    sendStream.queuedBytes += message.length();
+    return true;
+}
+
+/* Sends message, or queues it if ws is streaming. Queued messages count as backpressure */
+template <bool SSL>
+static inline typename uWS::WebSocket<SSL, true, PerSocketData>::SendStatus sendBehindSendStream(uWS::WebSocket<SSL, true, PerSocketData> *ws, std::string_view message, uWS::OpCode opCode, bool compress) {
+    typedef uWS::WebSocket<SSL, true, PerSocketData> WebSocket;
+
+    SendStream *sendStream = getSendStream(ws);
+    if (!sendStream) {
+        return ws->send(message, opCode, compress);
+    }
+    return queueBehindSendStream(*sendStream, message, opCode, compress) ? WebSocket::BACKPRESSURE : WebSocket::DROPPED;
+}
+
+/* Whether ws is subscribed to the exact topic through its stream */
+static inline bool isSubscribedBySendStream(void *ws, std::string_view topic) {
+    SendStream *sendStream = getSendStream(ws);
+    return sendStream && std::find(sendStream->topics.begin(), sendStream->topics.end(), topic) != sendStream->topics.end();
+}
+
+/* Publishes to the streaming WebSockets of app subscribed to topic, which µWS no longer knows about. Returns how many it reached */
+static inline unsigned int publishToSendStreams(void *app, std::string_view topic, std::string_view message, uWS::OpCode opCode, bool compress, bool conflate, void *publisher = nullptr) {
+    unsigned int delivered = 0;
+    for (auto &[ws, sendStream] : sendStreams) {
+        if (ws == publisher || sendStream.app != app || std::find(sendStream.topics.begin(), sendStream.topics.end(), topic) == sendStream.topics.end()) {
+            continue;
+        }
+        /* Conflated publishes wait for the stream like for any slow subscriber */
+        if (conflate) {
+            deferConflated(ws, topic, message, opCode, compress);
+            delivered++;
+        } else {
+            delivered += queueBehindSendStream(sendStream, message, opCode, compress);
+        }
+    }
+    return delivered;
+}
+
+/* Takes the exact topics of ws from the topic tree for its new stream, after sending what it buffered for ws.
+ * Both may call into JS and close ws */
+template <bool SSL>
+static inline void takeSendStreamTopics(uWS::WebSocket<SSL, true, PerSocketData> *ws) {
+    auto *app = (uWS::TemplatedApp<SSL> *) ((PerSocketData *) ws->getUserData())->app;
+    if (app->topicTree) {
+        app->topicTree->drain();
+    }
+    if (!getSendStream(ws)) {
+        return;
+    }
+
+    std::vector<std::string> topics;
+    ws->iterateTopics([&topics](std::string_view topic) {
+        topics.emplace_back(topic);
+    });
+    for (std::string &topic : topics) {
+        SendStream *sendStream = getSendStream(ws);
+        if (!sendStream) {
+            return;
+        }
+        sendStream->topics.push_back(topic);
+        ws->unsubscribe(topic);
+    }
+}
+
+/* Pulls one chunk into chunk, returns false if the stream failed */
+static inline bool pullSendStream(Isolate *isolate, SendStream &sendStream, std::string &chunk) {
+    HandleScope hs(isolate);
+
+    Local<Value> argv[1] = {Integer::NewFromUnsigned(isolate, sendStream.fragmentSize)};
+    MaybeLocal<Value> maybeChunk = CallJS(isolate, Local<Function>::New(isolate, sendStream.pull), 1, argv);
+    Local<Value> chunkValue;
+    if (!maybeChunk.ToLocal(&chunkValue)) {
+        return false;
+    }
+
+    chunk.clear();
+    if (chunkValue->IsNullOrUndefined()) {
+        return true;
+    }
+    if (!chunkValue->IsString() && !chunkValue->IsArrayBuffer() && !chunkValue->IsArrayBufferView()) {
+        return false;
+    }
+
+    NativeString<true> nativeChunk(isolate, chunkValue);
+    chunk.assign(nativeChunk.getString());
+    return true;
+}
+
+/* Returns the next fragment, sets last if it is the last one. Returns false if the source failed */
+static inline bool readSendStream(Isolate *isolate, SendStream &sendStream, std::string_view &fragment, bool &last) {
+    /* Pull sources are one chunk ahead */
+    if (!sendStream.pull.IsEmpty()) {
+        if (!sendStream.started && !pullSendStream(isolate, sendStream, sendStream.nextChunk)) {
+            return false;
+        }
+        sendStream.chunk.swap(sendStream.nextChunk);
+        if (sendStream.chunk.empty()) {
+            last = true;
+        } else if (!pullSendStream(isolate, sendStream, sendStream.nextChunk)) {
+            return false;
+        } else {
+            last = sendStream.nextChunk.empty();
+        }
+        fragment = sendStream.chunk;
+        return true;
+    }
+
+    size_t fragmentLength = (size_t) std::min<uint64_t>(sendStream.length - sendStream.offset, sendStream.fragmentSize);
+    last = sendStream.offset + fragmentLength == sendStream.length;
+
+    if (sendStream.fd == -1) {
+        fragment = std::string_view(sendStream.data + sendStream.offset, fragmentLength);
+    } else {
+        sendStream.chunk.resize(fragmentLength);
+        size_t read = 0;
+        while (read < fragmentLength) {
+#ifdef _WIN32
+            _lseeki64(sendStream.fd, (__int64) (sendStream.offset + read), SEEK_SET);
+            int bytes = _read(sendStream.fd, sendStream.chunk.data() + read, (unsigned int) (fragmentLength - read));
+#else
+            ssize_t bytes = pread(sendStream.fd, sendStream.chunk.data() + read, fragmentLength - read, (off_t) (sendStream.offset + read));
+#endif
+            /* The file shrank or failed under us */
+            if (bytes <= 0) {
+                return false;
+            }
+            read += (size_t) bytes;
+        }
+        fragment = sendStream.chunk;
+    }
+
+    sendStream.offset += fragmentLength;
+    return true;
+}
+
+/* Ends the stream of ws, calling its callback. The stream must be in sendStreams */
+static inline void endSendStream(Isolate *isolate, void *ws, bool completed) {
+    auto it = sendStreams.find(ws);
+    UniquePersistent<Function> cb = std::move(it->second.cb);
+    sendStreams.erase(it);
+
+    if (!cb.IsEmpty()) {
+        HandleScope hs(isolate);
+        Local<Value> argv[1] = {Boolean::New(isolate, completed)};
+        CallJS(isolate, Local<Function>::New(isolate, cb), 1, argv);
+    }
+}
+
+/* Called when a WebSocket closes */
+static inline void dropSendStream(Isolate *isolate, void *ws) {
+    if (!sendStreams.empty() && sendStreams.contains(ws)) {
+        endSendStream(isolate, ws, false);
+    }
+}
+
+/* Sends fragments for as long as ws stays below the watermark, then what was queued meanwhile, then gives back
+ * the topics of ws and ends the stream. Called on start and on drain */
+template <bool SSL>
+static inline void pumpSendStream(Isolate *isolate, uWS::WebSocket<SSL, true, PerSocketData> *ws) {
+    typedef uWS::WebSocket<SSL, true, PerSocketData> WebSocket;
+
+    if (sendStreams.empty()) {
+        return;
+    }
+
+    while (true) {
+        /* Pull callbacks and sends may close any WebSocket. Closing ws drops its stream, so we look it up after those */
+        auto it = sendStreams.find(ws);
+        if (it == sendStreams.end()) {
+            return;
+        }
+        SendStream &sendStream = it->second;
+
+        /* Sending and subscribing may call into JS, which queues behind us until we end */
+        if (sendStream.ending) {
+            if (!sendStream.queue.empty()) {
+                if (ws->getBufferedAmount() > sendStream.watermark) {
+                    return;
+                }
+                QueuedMessage queuedMessage = std::move(sendStream.queue.front());
+                sendStream.queue.pop_front();
+                sendStream.queuedBytes -= queuedMessage.message.length();
+                ws->send(queuedMessage.message, queuedMessage.opCode, queuedMessage.compress);
+            } else if (!sendStream.topics.empty()) {
+                std::string topic = std::move(sendStream.topics.back());
+                sendStream.topics.pop_back();
+                ws->subscribe(topic);
+            } else {
+                /* Conflated publishes deferred meanwhile go out last */
+                unsigned long long closed = closedWebSockets;
+                endSendStream(isolate, ws, sendStream.completed);
+                if (closed == closedWebSockets) {
+                    flushConflated(ws);
+                }
+                return;
+            }
+            continue;
+        }
+
+        if (ws->getBufferedAmount() > sendStream.watermark) {
+            return;
+        }
+
+        unsigned long long closed = closedWebSockets;
+        std::string_view fragment;
+        bool last = false;
+        bool ok = readSendStream(isolate, sendStream, fragment, last);
+        if (closed != closedWebSockets && !sendStreams.contains(ws)) {
+            return;
+        }
+
+        /* A message started can only be ended by closing */
+        if (!ok) {
+            if (sendStream.started) {
+                ws->end(1011, "Stream failed");
+                return;
+            }
+            sendStream.ending = true;
+            continue;
+        }
+
+        typename WebSocket::SendStatus sendStatus;
+        if (!sendStream.started) {
+            sendStream.started = true;
+            sendStatus = last ? ws->send(fragment, sendStream.opCode, sendStream.compress) : ws->sendFirstFragment(fragment, sendStream.opCode, sendStream.compress);
+        } else {
+            sendStatus = last ? ws->sendLastFragment(fragment, sendStream.compress) : ws->sendFragment(fragment, sendStream.compress);
+        }
+
+        if (closed != closedWebSockets && !sendStreams.contains(ws)) {
+            return;
+        }
+
+        /* A dropped fragment breaks the message */
+        if (sendStatus == WebSocket::DROPPED) {
+            ws->end(1011, "Stream dropped");
+            return;
+        }
+
+        if (last) {
+            sendStream.ending = sendStream.completed = true;
+        }
+    }
+}
+
+#endif
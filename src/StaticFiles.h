@@ -0,0 +1,467 @@
+/*
+ * Authored by Alex Hultman, 2018-2026.
+ * Intellectual property of third-party.
+
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ADDON_STATICFILES_H
+#define ADDON_STATICFILES_H
+
+#include "App.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+/* An open regular file and its validators, closed once neither a cache nor a transfer holds it */
+struct OpenFile {
+    int fd = -1;
+    uint64_t size = 0;
+    /* Identity of the file, to notice it being replaced */
+    uint64_t inode = 0;
+    int64_t mtime = 0;
+    std::string etag;
+    std::string lastModified;
+    std::string_view contentType;
+
+    ~OpenFile() {
+        if (fd != -1) {
+#ifdef _WIN32
+            _close(fd);
+#else
+            close(fd);
+#endif
+        }
+    }
+
+    /* Returns nullptr if path is not a readable regular file */
+    static std::shared_ptr<OpenFile> open(const std::string &path) {
+#ifdef _WIN32
+        int fd = _open(path.c_str(), _O_RDONLY | _O_BINARY);
+        struct _stat64 st;
+        bool opened = fd != -1 && !_fstat64(fd, &st) && (st.st_mode & _S_IFREG);
+#else
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st;
+        bool opened = fd != -1 && !fstat(fd, &st) && S_ISREG(st.st_mode);
+#endif
+        std::shared_ptr<OpenFile> file = std::make_shared<OpenFile>();
+        file->fd = fd;
+        if (!opened) {
+            return nullptr;
+        }
+
+        file->size = (uint64_t) st.st_size;
+        file->inode = (uint64_t) st.st_ino;
+        file->mtime = (int64_t) st.st_mtime;
+
+        char etag[48];
+        snprintf(etag, sizeof(etag), "\"%llx-%llx\"", (unsigned long long) file->size, (unsigned long long) file->mtime);
+        file->etag = etag;
+        file->lastModified = httpDate(file->mtime);
+        file->contentType = contentTypeOf(path);
+        return file;
+    }
+
+    /* Returns a duplicate of fd, or nullptr if fd is not a readable regular file */
+    static std::shared_ptr<OpenFile> duplicate(int fd) {
+#ifdef _WIN32
+        fd = _dup(fd);
+        struct _stat64 st;
+        bool opened = fd != -1 && !_fstat64(fd, &st) && (st.st_mode & _S_IFREG);
+#else
+        fd = dup(fd);
+        struct stat st;
+        bool opened = fd != -1 && !fstat(fd, &st) && S_ISREG(st.st_mode);
+#endif
+        std::shared_ptr<OpenFile> file = std::make_shared<OpenFile>();
+        file->fd = fd;
+        if (!opened) {
+            return nullptr;
+        }
+
+        file->size = (uint64_t) st.st_size;
+        return file;
+    }
+
+    /* Whether path still is this file */
+    bool isCurrent(const std::string &path) const {
+#ifdef _WIN32
+        struct _stat64 st;
+        return !_stat64(path.c_str(), &st) && (uint64_t) st.st_size == size && (uint64_t) st.st_ino == inode && (int64_t) st.st_mtime == mtime;
+#else
+        struct stat st;
+        return !stat(path.c_str(), &st) && (uint64_t) st.st_size == size && (uint64_t) st.st_ino == inode && (int64_t) st.st_mtime == mtime;
+#endif
+    }
+
+    /* Reads length bytes at offset, returns false if the file shrank or failed under us */
+    bool read(char *data, size_t length, uint64_t offset) const {
+        size_t read = 0;
+        while (read < length) {
+#ifdef _WIN32
+            _lseeki64(fd, (__int64) (offset + read), SEEK_SET);
+            int bytes = _read(fd, data + read, (unsigned int) (length - read));
+#else
+            ssize_t bytes = pread(fd, data + read, length - read, (off_t) (offset + read));
+#endif
+            if (bytes <= 0) {
+                return false;
+            }
+            read += (size_t) bytes;
+        }
+        return true;
+    }
+
+    static std::string httpDate(int64_t seconds) {
+        static const char *days[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+        static const char *months[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+        time_t time = (time_t) seconds;
+        struct tm tm;
+#ifdef _WIN32
+        gmtime_s(&tm, &time);
+#else
+        gmtime_r(&time, &tm);
+#endif
+        char date[32];
+        snprintf(date, sizeof(date), "%s, %02d %s %04d %02d:%02d:%02d GMT", days[tm.tm_wday], tm.tm_mday, months[tm.tm_mon], tm.tm_year + 1900, tm.tm_hour, tm.tm_min, tm.tm_sec);
+        return date;
+    }
+
+    static std::string_view contentTypeOf(std::string_view path) {
+        static const std::pair<std::string_view, std::string_view> contentTypes[] = {
+            {"html", "text/html; charset=utf-8"}, {"htm", "text/html; charset=utf-8"}, {"css", "text/css; charset=utf-8"},
+            {"js", "text/javascript; charset=utf-8"}, {"mjs", "text/javascript; charset=utf-8"}, {"json", "application/json"},
+            {"map", "application/json"}, {"txt", "text/plain; charset=utf-8"}, {"xml", "application/xml"},
+            {"svg", "image/svg+xml"}, {"png", "image/png"}, {"jpg", "image/jpeg"}, {"jpeg", "image/jpeg"},
+            {"gif", "image/gif"}, {"webp", "image/webp"}, {"avif", "image/avif"}, {"ico", "image/x-icon"},
+            {"wasm", "application/wasm"}, {"woff", "font/woff"}, {"woff2", "font/woff2"}, {"ttf", "font/ttf"},
+            {"otf", "font/otf"}, {"mp4", "video/mp4"}, {"webm", "video/webm"}, {"ogg", "audio/ogg"},
+            {"mp3", "audio/mpeg"}, {"wav", "audio/wav"}, {"pdf", "application/pdf"}, {"zip", "application/zip"}
+        };
+
+        size_t dot = path.rfind('.');
+        if (dot != std::string_view::npos && path.find('/', dot) == std::string_view::npos) {
+            std::string_view extension = path.substr(dot + 1);
+            for (auto &[knownExtension, contentType] : contentTypes) {
+                if (extension.length() == knownExtension.length() && std::equal(extension.begin(), extension.end(), knownExtension.begin(), [](char a, char b) {
+                    return (char) tolower((unsigned char) a) == b;
+                })) {
+                    return contentType;
+                }
+            }
+        }
+        return "application/octet-stream";
+    }
+};
+
+enum class FilePump {
+    SENT,
+    BACKPRESSURE,
+    FAILED
+};
+
+/* Writes length bytes of file from start as the body of res from bodyStart on, in a body of totalSize, continuing
+ * from the write offset of res until backpressure. Files shrinking or failing under us fail, as the length is promised */
+template <bool SSL>
+static inline FilePump pumpFile(uWS::HttpResponse<SSL> *res, OpenFile *file, uint64_t start, uint64_t length, uint64_t bodyStart, uint64_t totalSize) {
+    thread_local char chunk[64 * 1024];
+
+    while (true) {
+        uint64_t sent = res->getWriteOffset() - bodyStart;
+        size_t chunkLength = (size_t) std::min<uint64_t>(sizeof(chunk), length - sent);
+        if (!file->read(chunk, chunkLength, start + sent)) {
+            return FilePump::FAILED;
+        }
+
+        auto [ok, hasResponded] = res->tryEnd(std::string_view(chunk, chunkLength), totalSize);
+        if (hasResponded || (ok && sent + chunkLength == length)) {
+            return FilePump::SENT;
+        }
+        if (!ok) {
+            return FilePump::BACKPRESSURE;
+        }
+    }
+}
+
+/* Sends length bytes of file from start as the whole body of res natively, resuming on writable. The file is held until done or aborted */
+template <bool SSL>
+static inline void sendFile(uWS::HttpResponse<SSL> *res, std::shared_ptr<OpenFile> file, uint64_t start, uint64_t length) {
+    FilePump pumped = pumpFile(res, file.get(), start, length, 0, length);
+    if (pumped != FilePump::BACKPRESSURE) {
+        if (pumped == FilePump::FAILED) {
+            res->close();
+        }
+        return;
+    }
+
+    /* µWS drops both handlers, and with them the file, once res is done or aborted */
+    res->onWritable([res, file = std::move(file), start, length](uintmax_t) {
+        FilePump pumped = pumpFile(res, file.get(), start, length, 0, length);
+        if (pumped == FilePump::FAILED) {
+            res->close();
+        }
+        return pumped == FilePump::SENT;
+    })->onAborted([]() {});
+}
+
+/* Parses a Range header of a single byte range against size. Multiple ranges are not supported and, like
+ * anything not a byte range, served in full */
+enum class ByteRange {
+    NONE,
+    SATISFIABLE,
+    UNSATISFIABLE
+};
+
+static inline bool parseRangeNumber(std::string_view number, uint64_t &value) {
+    if (number.empty() || number.length() > 19) {
+        return false;
+    }
+    value = 0;
+    for (char c : number) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        value = value * 10 + (uint64_t) (c - '0');
+    }
+    return true;
+}
+
+static inline ByteRange parseByteRange(std::string_view header, uint64_t size, uint64_t &start, uint64_t &length) {
+    if (header.substr(0, 6) != "bytes=" || header.find(',') != std::string_view::npos) {
+        return ByteRange::NONE;
+    }
+    header.remove_prefix(6);
+    while (header.length() && header.front() == ' ') {
+        header.remove_prefix(1);
+    }
+    while (header.length() && header.back() == ' ') {
+        header.remove_suffix(1);
+    }
+
+    size_t dash = header.find('-');
+    if (dash == std::string_view::npos) {
+        return ByteRange::NONE;
+    }
+
+    uint64_t first, last;
+    if (dash == 0) {
+        /* The last bytes */
+        if (!parseRangeNumber(header.substr(1), last)) {
+            return ByteRange::NONE;
+        }
+        if (!last || !size) {
+            return ByteRange::UNSATISFIABLE;
+        }
+        length = std::min(last, size);
+        start = size - length;
+        return ByteRange::SATISFIABLE;
+    }
+
+    if (!parseRangeNumber(header.substr(0, dash), first)) {
+        return ByteRange::NONE;
+    }
+    if (dash + 1 == header.length()) {
+        last = UINT64_MAX;
+    } else if (!parseRangeNumber(header.substr(dash + 1), last) || last < first) {
+        return ByteRange::NONE;
+    }
+    if (first >= size) {
+        return ByteRange::UNSATISFIABLE;
+    }
+    start = first;
+    length = std::min(last, size - 1) - first + 1;
+    return ByteRange::SATISFIABLE;
+}
+
+/* Serves a directory under a URL prefix. Open files are cached with their validators and checked against
+ * the directory at most once a second, so edits show up without reopening files on every request */
+struct StaticFiles {
+    std::string prefix;
+    std::string directory;
+    /* Served for paths ending in /, none if empty */
+    std::string index = "index.html";
+    /* Cache-Control of every response, none if empty */
+    std::string cacheControl;
+    size_t maxOpenFiles = 256;
+
+private:
+    struct CachedFile {
+        std::shared_ptr<OpenFile> file;
+        std::chrono::steady_clock::time_point checked;
+    };
+
+    std::unordered_map<std::string, CachedFile> files;
+
+    static int hexValue(char c) {
+        if (c >= '0' && c <= '9') {
+            return c - '0';
+        }
+        c = (char) tolower((unsigned char) c);
+        return c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+    }
+
+    /* Returns the path of the file of url, empty if it is not below directory */
+    std::string resolve(std::string_view url) {
+        url.remove_prefix(std::min(url.length(), prefix.length()));
+
+        std::string path;
+        path.reserve(directory.length() + url.length() + index.length() + 1);
+        path.append(directory);
+        if (url.empty() || url.front() != '/') {
+            path.push_back('/');
+        }
+
+        size_t segment = path.length();
+        for (size_t i = 0; i < url.length(); i++) {
+            char c = url[i];
+            if (c == '%') {
+                if (i + 2 >= url.length()) {
+                    return {};
+                }
+                int high = hexValue(url[i + 1]), low = hexValue(url[i + 2]);
+                /* No NUL either, it would cut the path short */
+                if (high == -1 || low == -1 || !(high | low)) {
+                    return {};
+                }
+                c = (char) (high << 4 | low);
+                i += 2;
+            }
+            if (c == '\\') {
+                return {};
+            }
+            if (c == '/') {
+                if (std::string_view(path).substr(segment) == "..") {
+                    return {};
+                }
+                path.push_back(c);
+                segment = path.length();
+                continue;
+            }
+            path.push_back(c);
+        }
+        if (std::string_view(path).substr(segment) == "..") {
+            return {};
+        }
+
+        if (path.back() == '/') {
+            if (index.empty()) {
+                return {};
+            }
+            path.append(index);
+        }
+        return path;
+    }
+
+    std::shared_ptr<OpenFile> lookup(const std::string &path) {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+        auto it = files.find(path);
+        if (it != files.end()) {
+            if (now - it->second.checked < std::chrono::seconds(1)) {
+                return it->second.file;
+            }
+            if (it->second.file->isCurrent(path)) {
+                it->second.checked = now;
+                return it->second.file;
+            }
+            files.erase(it);
+        }
+
+        std::shared_ptr<OpenFile> file = OpenFile::open(path);
+        if (file) {
+            if (files.size() >= maxOpenFiles) {
+                files.clear();
+            }
+            files[path] = {file, now};
+        }
+        return file;
+    }
+
+public:
+    template <bool SSL>
+    void serve(uWS::HttpResponse<SSL> *res, uWS::HttpRequest *req, bool head) {
+        std::string path = resolve(req->getUrl());
+        std::shared_ptr<OpenFile> file = path.length() ? lookup(path) : nullptr;
+        if (!file) {
+            res->writeStatus("404 Not Found")->end("Not Found");
+            return;
+        }
+
+        /* If-Modified-Since only counts without If-None-Match, and is compared as sent by us */
+        std::string_view ifNoneMatch = req->getHeader("if-none-match");
+        bool notModified = ifNoneMatch.length() ? ifNoneMatch == "*" || ifNoneMatch.find(file->etag) != std::string_view::npos
+                                                : req->getHeader("if-modified-since") == file->lastModified;
+        if (notModified) {
+            res->writeStatus("304 Not Modified");
+            writeValidators(res, file.get());
+            res->endWithoutBody();
+            return;
+        }
+
+        uint64_t start = 0, length = file->size;
+        std::string_view range = req->getHeader("range");
+        std::string_view ifRange = req->getHeader("if-range");
+        if (range.length() && (ifRange.empty() || ifRange == file->etag || ifRange == file->lastModified)) {
+            char contentRange[64];
+            switch (parseByteRange(range, file->size, start, length)) {
+            case ByteRange::UNSATISFIABLE:
+                snprintf(contentRange, sizeof(contentRange), "bytes */%llu", (unsigned long long) file->size);
+                res->writeStatus("416 Range Not Satisfiable")->writeHeader("Content-Range", contentRange)->end();
+                return;
+            case ByteRange::SATISFIABLE:
+                snprintf(contentRange, sizeof(contentRange), "bytes %llu-%llu/%llu", (unsigned long long) start, (unsigned long long) (start + length - 1), (unsigned long long) file->size);
+                res->writeStatus("206 Partial Content")->writeHeader("Content-Range", contentRange);
+                break;
+            case ByteRange::NONE:
+                break;
+            }
+        }
+
+        res->writeHeader("Content-Type", file->contentType)->writeHeader("Accept-Ranges", "bytes");
+        writeValidators(res, file.get());
+
+        if (head) {
+            res->endWithoutBody(length);
+            return;
+        }
+        sendFile(res, std::move(file), start, length);
+    }
+
+private:
+    template <bool SSL>
+    void writeValidators(uWS::HttpResponse<SSL> *res, OpenFile *file) {
+        res->writeHeader("ETag", file->etag)->writeHeader("Last-Modified", file->lastModified);
+        if (cacheControl.length()) {
+            res->writeHeader("Cache-Control", cacheControl);
+        }
+    }
+};
+
+#endif
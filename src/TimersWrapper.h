@@ -0,0 +1,334 @@
+/*
+ * Authored by Alex Hultman, 2018-2026.
+ * Intellectual property of third-party.
+
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ADDON_TIMERSWRAPPER_H
+#define ADDON_TIMERSWRAPPER_H
+
+/* Faster setTimeout, setInterval, clearTimeout and timers owned by sockets */
+
+#include "App.h"
+#include "Utilities.h"
+#include "FastTimers.h"
+
+#include <chrono>
+#include <unordered_map>
+
+#include <v8.h>
+using namespace v8;
+
+/* Every loop has its own wheel, driven by one uSockets timer armed only while there are timers set */
+struct FastTimersDriver {
+    FastTimers wheel;
+
+    /* Parallel to the timer slab, indexed by FastTimers::offsetOf */
+    struct Slot {
+        /* Empty for timers delivered to the expired handler */
+        UniquePersistent<Function> cb;
+        /* The ws or res the timer belongs to, passed to cb */
+        UniquePersistent<Object> socketObject;
+        /* Native socket owning this timer, or nullptr */
+        void *owner = nullptr;
+    };
+    std::vector<Slot> slots;
+
+    /* Timers of every native socket, cleared when the socket closes */
+    std::unordered_map<void *, std::vector<FastTimers::Handle>> ownedTimers;
+
+    /* Receives all timers without callback expiring in one tick, as one Float64Array */
+    UniquePersistent<Function> expiredHandler;
+    std::vector<double> expiredBatch;
+    Isolate *isolate;
+    struct us_timer_t *driver;
+    unsigned int driverMs = 10;
+    bool armed = false;
+    std::chrono::steady_clock::time_point nextTick;
+
+    FastTimersDriver(Isolate *isolate);
+
+    /* Releases what the slot holds and detaches it from its owner */
+    void releaseSlot(FastTimers::Handle timer) {
+        Slot &slot = slots[FastTimers::offsetOf(timer)];
+        if (slot.owner) {
+            auto it = ownedTimers.find(slot.owner);
+            std::vector<FastTimers::Handle> &timers = it->second;
+            for (FastTimers::Handle &owned : timers) {
+                if (owned == timer) {
+                    owned = timers.back();
+                    timers.pop_back();
+                    break;
+                }
+            }
+            if (timers.empty()) {
+                ownedTimers.erase(it);
+            }
+            slot.owner = nullptr;
+        }
+        slot.cb.Reset();
+        slot.socketObject.Reset();
+    }
+};
+
+thread_local FastTimersDriver *fastTimers = nullptr;
+
+void onFastTimers(FastTimers::Handle *timers, unsigned int count, void *user) {
+    FastTimersDriver *fastTimers = (FastTimersDriver *) user;
+    Isolate *isolate = fastTimers->isolate;
+    HandleScope hs(isolate);
+
+    fastTimers->expiredBatch.clear();
+    for (unsigned int i = 0; i < count; i++) {
+        FastTimers::Handle timer = timers[i];
+
+        /* An earlier callback of this batch may have cleared this timer */
+        if (!fastTimers->wheel.isExpired(timer)) {
+            continue;
+        }
+
+        FastTimersDriver::Slot &slot = fastTimers->slots[FastTimers::offsetOf(timer)];
+        if (slot.cb.IsEmpty()) {
+            fastTimers->expiredBatch.push_back((double) timer);
+            continue;
+        }
+
+        /* The handle of a timeout may be reused from within the callback, so release it first */
+        Local<Function> cb = Local<Function>::New(isolate, slot.cb);
+        Local<Value> argv[1];
+        int argc = 0;
+        if (!slot.socketObject.IsEmpty()) {
+            argv[argc++] = Local<Object>::New(isolate, slot.socketObject);
+        }
+        if (!fastTimers->wheel.isRepeating(timer)) {
+            fastTimers->releaseSlot(timer);
+        }
+
+        CallJS(isolate, cb, argc, argv);
+    }
+
+    /* One call for all the timers without callback */
+    if (fastTimers->expiredHandler.IsEmpty()) {
+        return;
+    }
+    std::erase_if(fastTimers->expiredBatch, [fastTimers](double timer) {
+        return !fastTimers->wheel.isExpired((FastTimers::Handle) timer);
+    });
+    if (fastTimers->expiredBatch.size()) {
+        size_t length = fastTimers->expiredBatch.size() * sizeof(double);
+        Local<ArrayBuffer> expiredArrayBuffer = ArrayBuffer_NewCopy(isolate, fastTimers->expiredBatch.data(), length);
+        Local<Value> argv[] = {Float64Array::New(expiredArrayBuffer, 0, fastTimers->expiredBatch.size())};
+        CallJS(isolate, Local<Function>::New(isolate, fastTimers->expiredHandler), 1, argv);
+    }
+}
+
+void onFastTimersDriver(struct us_timer_t *t) {
+    /* System timers drift, catch up on every 10ms tick that has passed. The boundary of the
+     * tick being run is always nextTick - 10ms, also for timers set from within the callbacks */
+    auto now = std::chrono::steady_clock::now();
+    while (fastTimers->wheel.getActiveTimers() && fastTimers->nextTick <= now) {
+        fastTimers->nextTick += std::chrono::milliseconds(10);
+        fastTimers->wheel.advance();
+    }
+
+    if (!fastTimers->wheel.getActiveTimers()) {
+        us_timer_set(t, onFastTimersDriver, 0, 0);
+        fastTimers->armed = false;
+    }
+}
+
+FastTimersDriver::FastTimersDriver(Isolate *isolate) : wheel(onFastTimers, this), isolate(isolate) {
+    driver = us_create_timer((struct us_loop_t *) uWS::Loop::get(), 0, 0);
+}
+
+void armFastTimersDriver() {
+    /* Ticks are counted from when we (re)start ticking */
+    fastTimers->nextTick = std::chrono::steady_clock::now() + std::chrono::milliseconds(10);
+    us_timer_set(fastTimers->driver, onFastTimersDriver, fastTimers->driverMs, fastTimers->driverMs);
+    fastTimers->armed = true;
+}
+
+/* Sets a timer on this loop's wheel, lazily starting the wheel. Returns FastTimers::NO_TIMER if out of timers */
+FastTimers::Handle setFastTimer(Isolate *isolate, uint32_t ms, bool repeat, UniquePersistent<Function> &&cb) {
+    if (!fastTimers) {
+        fastTimers = new FastTimersDriver(isolate);
+    }
+    if (!fastTimers->armed) {
+        armFastTimersDriver();
+    }
+
+    /* How far past the boundary of the current tick we are, timers count from now and not from that boundary */
+    auto elapsed = std::chrono::steady_clock::now() - (fastTimers->nextTick - std::chrono::milliseconds(10));
+    long long elapsedUs = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+
+    FastTimers::Handle timer = fastTimers->wheel.setTimeout(ms, repeat, std::max<long long>(0, elapsedUs));
+    if (timer == FastTimers::NO_TIMER) {
+        return FastTimers::NO_TIMER;
+    }
+    if (FastTimers::offsetOf(timer) >= fastTimers->slots.size()) {
+        fastTimers->slots.resize(fastTimers->wheel.getCapacity());
+    }
+
+    fastTimers->slots[FastTimers::offsetOf(timer)].cb = std::move(cb);
+
+    return timer;
+}
+
+/* Clearing a fired, cleared or invalid timer does nothing, also when its slot was reused since */
+void clearFastTimer(FastTimers::Handle timer) {
+    if (!fastTimers || !fastTimers->wheel.clearTimeout(timer)) {
+        return;
+    }
+
+    fastTimers->releaseSlot(timer);
+}
+
+/* Sets a timer calling cb with socketObject, cleared by clearSocketTimers(owner) unless it fired or was cleared before */
+FastTimers::Handle setSocketTimer(Isolate *isolate, void *owner, Local<Object> socketObject, uint32_t ms, bool repeat, UniquePersistent<Function> &&cb) {
+    FastTimers::Handle timer = setFastTimer(isolate, ms, repeat, std::move(cb));
+    if (timer == FastTimers::NO_TIMER) {
+        return FastTimers::NO_TIMER;
+    }
+
+    FastTimersDriver::Slot &slot = fastTimers->slots[FastTimers::offsetOf(timer)];
+    slot.socketObject.Reset(isolate, socketObject);
+    slot.owner = owner;
+    fastTimers->ownedTimers[owner].push_back(timer);
+
+    return timer;
+}
+
+/* Called when a socket closes, costs one hash lookup for sockets without timers */
+void clearSocketTimers(void *owner) {
+    if (!fastTimers || fastTimers->ownedTimers.empty()) {
+        return;
+    }
+
+    auto it = fastTimers->ownedTimers.find(owner);
+    if (it == fastTimers->ownedTimers.end()) {
+        return;
+    }
+
+    std::vector<FastTimers::Handle> timers = std::move(it->second);
+    fastTimers->ownedTimers.erase(it);
+
+    for (FastTimers::Handle timer : timers) {
+        fastTimers->wheel.clearTimeout(timer);
+        fastTimers->slots[FastTimers::offsetOf(timer)].owner = nullptr;
+        fastTimers->releaseSlot(timer);
+    }
+}
+
+/* Reads the ms of a timer, throwing and returning false for anything but a number from 0 to 2^32 - 1 */
+bool getTimerMs(const FunctionCallbackInfo<Value> &args, int index, uint32_t *ms) {
+    Isolate *isolate = args.GetIsolate();
+    double value = args[index]->IsNumber() ? Local<Number>::Cast(args[index])->Value() : -1;
+    if (!(value >= 0 && value <= UINT_MAX)) {
+        args.GetReturnValue().Set(isolate->ThrowException(v8::Exception::Error(String::NewFromUtf8(isolate, "Timer ms must be a number from 0 to 4294967295.", NewStringType::kNormal).ToLocalChecked())));
+        return false;
+    }
+    *ms = (uint32_t) value;
+    return true;
+}
+
+void uWS_arm(const FunctionCallbackInfo<Value> &args) {
+
+    /* integer */
+
+    uint32_t ms;
+    if (!getTimerMs(args, 0, &ms)) {
+        return;
+    }
+
+    if (!fastTimers) {
+        fastTimers = new FastTimersDriver(args.GetIsolate());
+    }
+
+    /* Sets how often the driver fires, in multiples of the 10ms resolution. Coarser driving
+     * trades precision for fewer wakeups, all passed ticks are still run */
+    fastTimers->driverMs = std::max<uint32_t>(10, ms - ms % 10);
+
+    if (fastTimers->armed) {
+        us_timer_set(fastTimers->driver, onFastTimersDriver, fastTimers->driverMs, fastTimers->driverMs);
+    }
+}
+
+/* Function or null, integer. Timers without callback are delivered to the expired handler */
+void setFastTimer(const FunctionCallbackInfo<Value> &args, bool repeat) {
+    UniquePersistent<Function> cb;
+    if (!args[0]->IsNullOrUndefined()) {
+        Callback checkedCallback(args.GetIsolate(), args[0]);
+        if (checkedCallback.isInvalid(args)) {
+            return;
+        }
+        cb = checkedCallback.getFunction();
+    }
+
+    uint32_t ms;
+    if (!getTimerMs(args, 1, &ms)) {
+        return;
+    }
+
+    FastTimers::Handle timer = setFastTimer(args.GetIsolate(), ms, repeat, std::move(cb));
+    if (timer == FastTimers::NO_TIMER) {
+        args.GetReturnValue().Set(args.GetIsolate()->ThrowException(v8::Exception::Error(String::NewFromUtf8(args.GetIsolate(), "Too many timers.", NewStringType::kNormal).ToLocalChecked())));
+        return;
+    }
+
+    args.GetReturnValue().Set(Number::New(args.GetIsolate(), (double) timer));
+}
+
+void uWS_setTimeout(const FunctionCallbackInfo<Value> &args) {
+    setFastTimer(args, false);
+}
+
+void uWS_setInterval(const FunctionCallbackInfo<Value> &args) {
+    setFastTimer(args, true);
+}
+
+/* Clears timeouts, intervals and socket timers alike, also from within any timer callback */
+void uWS_clearTimeout(const FunctionCallbackInfo<Value> &args) {
+
+    /* Handles are integers below 2^53, anything else is no timer */
+    if (!args[0]->IsNumber()) {
+        return;
+    }
+
+    double timer = Local<Number>::Cast(args[0])->Value();
+    if (!(timer >= 0 && timer < 9007199254740992.0) || timer != (double) (FastTimers::Handle) timer) {
+        return;
+    }
+
+    clearFastTimer((FastTimers::Handle) timer);
+}
+
+/* Function or null */
+void uWS_onExpired(const FunctionCallbackInfo<Value> &args) {
+    if (!fastTimers) {
+        fastTimers = new FastTimersDriver(args.GetIsolate());
+    }
+
+    if (args[0]->IsNullOrUndefined()) {
+        fastTimers->expiredHandler.Reset();
+        return;
+    }
+
+    Callback checkedCallback(args.GetIsolate(), args[0]);
+    if (checkedCallback.isInvalid(args)) {
+        return;
+    }
+    fastTimers->expiredHandler = checkedCallback.getFunction();
+}
+
+#endif
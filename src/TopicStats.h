@@ -0,0 +1,67 @@
+/*
+ * Authored by Alex Hultman, 2018-2026.
+ * Intellectual property of third-party.
+
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ADDON_TOPICSTATS_H
+#define ADDON_TOPICSTATS_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/* Publishes and bytes published by topic, since last taken. Only kept for apps asking for it */
+struct TopicStats {
+    struct Counters {
+        uint64_t publishes = 0;
+        uint64_t bytes = 0;
+    };
+
+    /* Looked up by string_view without allocating */
+    struct Hash {
+        using is_transparent = void;
+        size_t operator()(std::string_view topic) const {
+            return std::hash<std::string_view>()(topic);
+        }
+    };
+
+    std::unordered_map<std::string, Counters, Hash, std::equal_to<>> topics;
+
+    void count(std::string_view topic, size_t length) {
+        auto it = topics.find(topic);
+        if (it == topics.end()) {
+            it = topics.emplace(std::string(topic), Counters{}).first;
+        }
+        it->second.publishes++;
+        it->second.bytes += length;
+    }
+};
+
+thread_local std::unordered_map<void *, TopicStats> appTopicStats;
+
+/* Counts a publish of app, costs nothing for apps without stats */
+static inline void countPublish(void *app, std::string_view topic, size_t length) {
+    if (appTopicStats.empty()) {
+        return;
+    }
+    auto it = appTopicStats.find(app);
+    if (it != appTopicStats.end()) {
+        it->second.count(topic, length);
+    }
+}
+
+#endif
@@ -21,24 +21,28 @@
 #include <openssl/ssl.h>
 #include <openssl/x509.h>
 #include <v8.h>
+#include <chrono>
+#include <unordered_map>
+#include "RequestLimiter.h"
+#include "LatencyHistogram.h"
 using namespace v8;
 
 /* Getting internal pointer is different in recent V8 versions */
 #if (V8_MAJOR_VERSION == 14)
-    void *getInternalPointer(const Local<Object> &holder) {
-        return holder->GetAlignedPointerFromInternalField(0, 0);
+    void *getInternalPointer(const Local<Object> &holder, int field = 0) {
+        return holder->GetAlignedPointerFromInternalField(field, 0);
     }
 
-    void setInternalPointer(const Local<Object> &holder, void *value) {
-        holder->SetAlignedPointerInInternalField(0, value, 0);
+    void setInternalPointer(const Local<Object> &holder, void *value, int field = 0) {
+        holder->SetAlignedPointerInInternalField(field, value, 0);
     }
 #else
-    void *getInternalPointer(const Local<Object> &holder) {
-        return holder->GetAlignedPointerFromInternalField(0);
+    void *getInternalPointer(const Local<Object> &holder, int field = 0) {
+        return holder->GetAlignedPointerFromInternalField(field);
     }
 
-    void setInternalPointer(const Local<Object> &holder, void *value) {
-        holder->SetAlignedPointerInInternalField(0, value);
+    void setInternalPointer(const Local<Object> &holder, void *value, int field = 0) {
+        holder->SetAlignedPointerInInternalField(field, value);
     }
 #endif
 
@@ -67,8 +71,150 @@ Local<v8::ArrayBuffer> ArrayBuffer_NewCopy(Isolate *isolate, void *data, size_t
     return ab;
 }
 
+struct AssetCache;
+
+/* Native per socket fields declared by a behavior, laid out in one block kept out of the JS heap */
+struct SlotSchema {
+    enum Type : uint8_t {
+        INT32, FLOAT64, BYTES
+    };
+
+    struct Slot {
+        Type type;
+        uint32_t offset;
+        /* Capacity of BYTES slots, which are prefixed by their used length */
+        uint32_t capacity;
+    };
+
+    std::vector<Slot> slots;
+    uint32_t size = 0;
+
+    /* Opted in with weakObjects, the JS objects of idle sockets may then be collected */
+    bool weakObjects = false;
+
+    /* Per socket, so meant for small fields */
+    static constexpr uint32_t MAX_SIZE = 64 * 1024;
+
+    /* Returns false if the block would grow past MAX_SIZE */
+    bool add(Type type, uint32_t capacity = 0) {
+        uint64_t alignment = type == FLOAT64 ? 8 : 4;
+        uint64_t offset = (size + alignment - 1) & ~(alignment - 1);
+        uint64_t end = offset + (type == INT32 ? 4 : type == FLOAT64 ? 8 : 4 + (uint64_t) capacity);
+        if (end > MAX_SIZE) {
+            return false;
+        }
+        slots.push_back({type, (uint32_t) offset, capacity});
+        size = (uint32_t) end;
+        return true;
+    }
+};
+
+/* Slow consumer counters of a behavior, kept natively for all its sockets */
+struct WebSocketStats {
+    uint64_t droppedMessages = 0;
+    uint64_t droppedBytes = 0;
+    uint64_t backpressureCloses = 0;
+    uint64_t drains = 0;
+    /* Sampled on drain, drop and close */
+    uint32_t maxBufferedAmount = 0;
+
+    void sampleBufferedAmount(uint32_t bufferedAmount) {
+        if (bufferedAmount > maxBufferedAmount) {
+            maxBufferedAmount = bufferedAmount;
+        }
+    }
+};
+
 struct PerSocketData {
+    /* Weak for behaviors with slots and weakObjects */
     UniquePersistent<Object> socketPf;
+    bool closed = false;
+
+    /* The app this socket belongs to, set on open */
+    void *app = nullptr;
+
+    /* Token buckets of the behavior rate limit, filled on open */
+    float messageTokens = 0, byteTokens = 0;
+    uint32_t rateLimitRefillMs = 0;
+
+    /* Conflated publishes are deferred while buffering more than this, set on open */
+    uint32_t conflationWatermark = 0;
+
+    /* Sends queued behind a send stream are dropped past this many bytes, 0 if unlimited. Set on open */
+    uint32_t maxBackpressure = 0;
+
+    /* Compression size cap, sends longer than this are never deflated, 0 if unlimited */
+    uint32_t maxCompressLength = 0;
+
+    /* Native fields of the behavior, allocated on open and freed on close */
+    const SlotSchema *slotSchema = nullptr;
+    char *slots = nullptr;
+
+    /* Shared by all sockets of the behavior, set on open */
+    WebSocketStats *stats = nullptr;
+    /* Set on the first drop closing this socket for backpressure */
+    bool closingForBackpressure = false;
+
+    /* Smoothed RTT in milliseconds of behaviors measuring it, 0 until the first pong */
+    float rtt = 0;
+    /* Send time of the latest probe, which is outstanding until its pong */
+    uint64_t rttProbeUs = 0;
+    bool rttProbeOutstanding = false;
+};
+
+/* How text messages are handed to the message handler, binary messages are always ArrayBuffers */
+enum class MessageFormat {
+    ARRAYBUFFER,
+    STRING,
+    JSON
+};
+
+/* Per behavior token bucket rate limit, enforced before calling into JS */
+struct RateLimit {
+    uint32_t maxMessagesPerSecond = 0;
+    uint32_t maxBytesPerSecond = 0;
+    bool closeOnRateLimit = false;
+
+    bool isEnabled() const {
+        return maxMessagesPerSecond || maxBytesPerSecond;
+    }
+
+    static uint32_t nowMs() {
+        return (uint32_t) std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /* Buckets hold at most one second worth of tokens */
+    void fill(PerSocketData *perSocketData) const {
+        perSocketData->messageTokens = (float) maxMessagesPerSecond;
+        perSocketData->byteTokens = (float) maxBytesPerSecond;
+        perSocketData->rateLimitRefillMs = nowMs();
+    }
+
+    /* Returns whether a message of length is within limits, taking its tokens if so.
+     * A message may take the byte bucket below zero, blocking until the debt is refilled */
+    bool take(PerSocketData *perSocketData, size_t length) const {
+        uint32_t now = nowMs();
+        float elapsedSeconds = (float) (now - perSocketData->rateLimitRefillMs) / 1000.0f;
+        perSocketData->rateLimitRefillMs = now;
+
+        if (maxMessagesPerSecond) {
+            perSocketData->messageTokens = std::min<float>(maxMessagesPerSecond, perSocketData->messageTokens + elapsedSeconds * maxMessagesPerSecond);
+            if (perSocketData->messageTokens < 1) {
+                return false;
+            }
+        }
+        if (maxBytesPerSecond) {
+            perSocketData->byteTokens = std::min<float>(maxBytesPerSecond, perSocketData->byteTokens + elapsedSeconds * maxBytesPerSecond);
+            if (perSocketData->byteTokens <= 0) {
+                return false;
+            }
+            perSocketData->byteTokens -= (float) length;
+        }
+        if (maxMessagesPerSecond) {
+            perSocketData->messageTokens -= 1;
+        }
+        return true;
+    }
 };
 
 struct PerContextData {
@@ -76,10 +222,24 @@ struct PerContextData {
     UniquePersistent<Object> reqTemplate[2]; // 0 = non-SSL/SSL, 1 = Http3
     UniquePersistent<Object> resTemplate[4]; // 0 = non-SSL, 1 = SSL, 2 = Http3
     UniquePersistent<Object> wsTemplate[2];
+    /* For telling WebSockets given as arguments apart, 0 = non-SSL, 1 = SSL */
+    UniquePersistent<FunctionTemplate> wsClass[2];
 
     /* We hold all apps until free */
     std::vector<std::unique_ptr<uWS::App>> apps;
     std::vector<std::unique_ptr<uWS::SSLApp>> sslApps;
+
+    /* Request rate limits of the apps having one, by app */
+    std::unordered_map<void *, std::unique_ptr<RequestLimiter>> requestLimiters;
+
+    /* WebSocket stats of every app, by pattern */
+    std::unordered_map<void *, std::unordered_map<std::string, std::shared_ptr<WebSocketStats>>> webSocketStats;
+
+    /* RTT of every app with behaviors measuring it */
+    std::unordered_map<void *, std::shared_ptr<LatencyHistogram>> rttHistograms;
+
+    /* In memory assets of every app having any */
+    std::unordered_map<void *, std::shared_ptr<AssetCache>> assetCaches;
 };
 
 template <class APP>
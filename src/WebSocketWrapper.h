@@ -17,6 +17,11 @@
 
 #include "App.h"
 #include "Utilities.h"
+#include "TimersWrapper.h"
+#include "WildcardTopics.h"
+#include "ConflatedTopics.h"
+#include "SendStream.h"
+#include "TopicStats.h"
 
 #include <v8.h>
 #include "v8-fast-api-calls.h"
@@ -41,6 +46,31 @@ struct WebSocketWrapper {
         setInternalPointer(args.This(), nullptr);
     }
 
+    /* Returns whether to compress message when asked to, by the length limit of the behavior */
+    template <bool SSL>
+    static inline bool shouldCompress(uWS::WebSocket<SSL, true, PerSocketData> *ws, std::string_view message, bool compress) {
+        unsigned int maxCompressLength = ((PerSocketData *) ws->getUserData())->maxCompressLength;
+        return compress && (!maxCompressLength || message.length() <= maxCompressLength);
+    }
+
+    /* How wildcard publishes reach our WebSockets */
+    template <bool SSL>
+    static bool sendToWildcardSubscriber(void *ws, std::string_view message, uWS::OpCode opCode, bool compress) {
+        return sendBehindSendStream((uWS::WebSocket<SSL, true, PerSocketData> *) ws, message, opCode, compress) != uWS::WebSocket<SSL, true, PerSocketData>::DROPPED;
+    }
+
+    template <bool SSL>
+    static void drainTopicTree(void *app) {
+        if (((uWS::TemplatedApp<SSL> *) app)->topicTree) {
+            ((uWS::TemplatedApp<SSL> *) app)->topicTree->drain();
+        }
+    }
+
+    template <bool SSL>
+    static bool isSubscribedExactly(void *ws, std::string_view topic) {
+        return ((uWS::WebSocket<SSL, true, PerSocketData> *) ws)->isSubscribed(topic) || isSubscribedBySendStream(ws, topic);
+    }
+
     /* Takes nothing returns holder (only used to fool TypeScript, as a conversion from WS to UserData) */
     template <bool SSL>
     static void uWS_WebSocket_getUserData(const FunctionCallbackInfo<Value> &args) {
@@ -57,6 +87,28 @@ struct WebSocketWrapper {
             if (topic.isInvalid(args)) {
                 return;
             }
+
+            /* Wildcard patterns are matched by us at publish time */
+            if (WildcardTopics::isWildcard(topic.getString())) {
+                AppWildcardTopics &wildcardTopics = appWildcardTopics[((PerSocketData *) ws->getUserData())->app];
+                wildcardTopics.send = sendToWildcardSubscriber<SSL>;
+                wildcardTopics.isSubscribed = isSubscribedExactly<SSL>;
+                wildcardTopics.drain = drainTopicTree<SSL>;
+                bool success = wildcardTopics.topics.subscribe(ws, topic.getString());
+                args.GetReturnValue().Set(Boolean::New(isolate, success));
+                return;
+            }
+
+            /* Streaming WebSockets hold on to their exact topics until the stream ends */
+            if (SendStream *sendStream = getSendStream(ws)) {
+                bool success = !ws->isSubscribed(topic.getString()) && !isSubscribedBySendStream(ws, topic.getString());
+                if (success) {
+                    sendStream->topics.emplace_back(topic.getString());
+                }
+                args.GetReturnValue().Set(Boolean::New(isolate, success));
+                return;
+            }
+
             bool success = ws->subscribe(topic.getString());
             args.GetReturnValue().Set(Boolean::New(isolate, success));
         }
@@ -72,6 +124,23 @@ struct WebSocketWrapper {
             if (topic.isInvalid(args)) {
                 return;
             }
+
+            if (WildcardTopics::isWildcard(topic.getString())) {
+                AppWildcardTopics *wildcardTopics = getAppWildcardTopics(((PerSocketData *) ws->getUserData())->app);
+                bool success = wildcardTopics && wildcardTopics->topics.unsubscribe(ws, topic.getString());
+                args.GetReturnValue().Set(Boolean::New(isolate, success));
+                return;
+            }
+
+            if (SendStream *sendStream = getSendStream(ws)) {
+                auto streamedTopic = std::find(sendStream->topics.begin(), sendStream->topics.end(), topic.getString());
+                if (streamedTopic != sendStream->topics.end()) {
+                    sendStream->topics.erase(streamedTopic);
+                    args.GetReturnValue().Set(Boolean::New(isolate, true));
+                    return;
+                }
+            }
+
             bool success = ws->unsubscribe(topic.getString());
             args.GetReturnValue().Set(Boolean::New(isolate, success));
         }
@@ -89,17 +158,26 @@ struct WebSocketWrapper {
 
             bool isBinary = args[2]->BooleanValue(isolate);
             bool compress = args[3]->BooleanValue(isolate);
+            bool conflate = args[4]->BooleanValue(isolate);
 
             NativeString<true> topic(isolate, args[0]);
             if (topic.isInvalid(args)) {
                 return;
             }
+
+            void *app = ((PerSocketData *) ws->getUserData())->app;
+
             NativeString<true> message(isolate, args[1]);
             if (message.isInvalid(args)) {
                 return;
             }
 
-            bool success = ws->publish(topic.getString(), message.getString(), isBinary ? uWS::OpCode::BINARY : uWS::OpCode::TEXT, compress);
+            compress = shouldCompress(ws, message.getString(), compress);
+            bool success = conflate ? publishConflated((uWS::TemplatedApp<SSL> *) app, topic.getString(), message.getString(), isBinary ? uWS::OpCode::BINARY : uWS::OpCode::TEXT, compress, ws)
+                : ws->publish(topic.getString(), message.getString(), isBinary ? uWS::OpCode::BINARY : uWS::OpCode::TEXT, compress);
+            success |= publishToWildcardSubscribers(app, topic.getString(), message.getString(), isBinary ? uWS::OpCode::BINARY : uWS::OpCode::TEXT, compress, ws) > 0;
+            success |= publishToSendStreams(app, topic.getString(), message.getString(), isBinary ? uWS::OpCode::BINARY : uWS::OpCode::TEXT, compress, conflate, ws) > 0;
+            countPublish(app, topic.getString(), message.getString().length());
             args.GetReturnValue().Set(Boolean::New(isolate, success));
         }
     }
@@ -107,6 +185,37 @@ struct WebSocketWrapper {
     /* It would make sense to call terminate "close" and call close "end" to line up with HTTP */
     /* That also makes sense seince close takes message and code -> you can end with a string message */
 
+    /* Takes ms, function of ws and optional repeat, returns timer. The timer is cleared when the socket closes */
+    template <bool SSL>
+    static void uWS_WebSocket_setTimer(const FunctionCallbackInfo<Value> &args) {
+        Isolate *isolate = args.GetIsolate();
+        auto *ws = getWebSocket<SSL>(args);
+        if (ws) {
+            if (missingArguments(2, args)) {
+                return;
+            }
+
+            uint32_t ms;
+            if (!getTimerMs(args, 0, &ms)) {
+                return;
+            }
+
+            Callback checkedCallback(isolate, args[1]);
+            if (checkedCallback.isInvalid(args)) {
+                return;
+            }
+
+            bool repeat = args[2]->BooleanValue(isolate);
+
+            FastTimers::Handle timer = setSocketTimer(isolate, ws, args.This(), ms, repeat, checkedCallback.getFunction());
+            if (timer == FastTimers::NO_TIMER) {
+                args.GetReturnValue().Set(isolate->ThrowException(v8::Exception::Error(String::NewFromUtf8(isolate, "Too many timers.", NewStringType::kNormal).ToLocalChecked())));
+                return;
+            }
+            args.GetReturnValue().Set(Number::New(isolate, (double) timer));
+        }
+    }
+
     /* Takes nothing returns nothing */
     template <bool SSL>
     static void uWS_WebSocket_close(const FunctionCallbackInfo<Value> &args) {
@@ -184,6 +293,17 @@ struct WebSocketWrapper {
         }
     }
 
+    /* Takes nothing, returns smoothed RTT in milliseconds, 0 until measured */
+    template <bool SSL>
+    static void uWS_WebSocket_getRtt(const FunctionCallbackInfo<Value> &args) {
+        Isolate *isolate = args.GetIsolate();
+        auto *ws = getWebSocket<SSL>(args);
+        if (ws) {
+            PerSocketData *perSocketData = (PerSocketData *) ws->getUserData();
+            args.GetReturnValue().Set(Number::New(isolate, perSocketData->rtt));
+        }
+    }
+
     /* Takes message, isBinary, compressed. Returns true on success, false otherwise */
     template <bool SSL>
     static void uWS_WebSocket_sendFirstFragment(const FunctionCallbackInfo<Value> &args) {
@@ -195,7 +315,8 @@ struct WebSocketWrapper {
                 return;
             }
 
-            unsigned int sendStatus = ws->sendFirstFragment(message.getString(), args[1]->BooleanValue(isolate) ? uWS::OpCode::BINARY : uWS::OpCode::TEXT, args[2]->BooleanValue(isolate));
+            /* Fragments would end up in the middle of the message being streamed */
+            unsigned int sendStatus = getSendStream(ws) ? uWS::WebSocket<SSL, true, PerSocketData>::DROPPED : ws->sendFirstFragment(message.getString(), args[1]->BooleanValue(isolate) ? uWS::OpCode::BINARY : uWS::OpCode::TEXT, args[2]->BooleanValue(isolate));
 
             args.GetReturnValue().Set(Integer::NewFromUnsigned(isolate, sendStatus));
         }
@@ -212,7 +333,7 @@ struct WebSocketWrapper {
                 return;
             }
 
-            unsigned int sendStatus = ws->sendFragment(message.getString(), args[1]->BooleanValue(isolate));
+            unsigned int sendStatus = getSendStream(ws) ? uWS::WebSocket<SSL, true, PerSocketData>::DROPPED : ws->sendFragment(message.getString(), args[1]->BooleanValue(isolate));
 
             args.GetReturnValue().Set(Integer::NewFromUnsigned(isolate, sendStatus));
         }
@@ -229,7 +350,7 @@ struct WebSocketWrapper {
                 return;
             }
 
-            unsigned int sendStatus = ws->sendLastFragment(message.getString(), args[1]->BooleanValue(isolate));
+            unsigned int sendStatus = getSendStream(ws) ? uWS::WebSocket<SSL, true, PerSocketData>::DROPPED : ws->sendLastFragment(message.getString(), args[1]->BooleanValue(isolate));
 
             args.GetReturnValue().Set(Integer::NewFromUnsigned(isolate, sendStatus));
         }
@@ -250,12 +371,275 @@ struct WebSocketWrapper {
                 return;
             }
 
-            unsigned int sendStatus = ws->send(message.getString(), isBinary ? uWS::OpCode::BINARY : uWS::OpCode::TEXT, compress);
+            unsigned int sendStatus = sendBehindSendStream(ws, message.getString(), isBinary ? uWS::OpCode::BINARY : uWS::OpCode::TEXT, shouldCompress(ws, message.getString(), compress));
 
             args.GetReturnValue().Set(Integer::NewFromUnsigned(isolate, sendStatus));
         }
     }
 
+    /* Takes array of messages, isBinary, compress. Returns the worst sendStatus of them all */
+    template <bool SSL>
+    static void uWS_WebSocket_sendMany(const FunctionCallbackInfo<Value> &args) {
+        Isolate *isolate = args.GetIsolate();
+        auto *ws = getWebSocket<SSL>(args);
+        if (ws) {
+            if (!args[0]->IsArray()) {
+                args.GetReturnValue().Set(isolate->ThrowException(v8::Exception::Error(String::NewFromUtf8(isolate, "sendMany requires an array of messages.", NewStringType::kNormal).ToLocalChecked())));
+                return;
+            }
+
+            Local<Array> messages = Local<Array>::Cast(args[0]);
+            uWS::OpCode opCode = args[1]->BooleanValue(isolate) ? uWS::OpCode::BINARY : uWS::OpCode::TEXT;
+            bool compress = args[2]->BooleanValue(isolate);
+
+            /* All frames go into one cork buffer and out in as few syscalls as possible */
+            bool backpressure = false, dropped = false, invalid = false;
+            ws->cork([&]() {
+                for (uint32_t i = 0; i < messages->Length(); i++) {
+                    Local<Value> messageValue = messages->Get(isolate->GetCurrentContext(), i).ToLocalChecked();
+
+                    NativeString<true> message(isolate, messageValue);
+                    if (message.isInvalid(args)) {
+                        invalid = true;
+                        return;
+                    }
+                    auto sendStatus = sendBehindSendStream(ws, message.getString(), opCode, shouldCompress(ws, message.getString(), compress));
+
+                    /* Dropping may close the socket, and would drop the rest anyways */
+                    if (sendStatus == uWS::WebSocket<SSL, true, PerSocketData>::DROPPED) {
+                        dropped = true;
+                        return;
+                    }
+                    backpressure |= sendStatus == uWS::WebSocket<SSL, true, PerSocketData>::BACKPRESSURE;
+                }
+            });
+
+            if (invalid) {
+                return;
+            }
+
+            unsigned int sendStatus = dropped ? uWS::WebSocket<SSL, true, PerSocketData>::DROPPED
+                : backpressure ? uWS::WebSocket<SSL, true, PerSocketData>::BACKPRESSURE : uWS::WebSocket<SSL, true, PerSocketData>::SUCCESS;
+            args.GetReturnValue().Set(Integer::NewFromUnsigned(isolate, sendStatus));
+        }
+    }
+
+    /* Returns the native field of index, or nullptr after throwing */
+    template <bool SSL>
+    static inline const SlotSchema::Slot *getSlot(const FunctionCallbackInfo<Value> &args, uWS::WebSocket<SSL, true, PerSocketData> *ws) {
+        Isolate *isolate = args.GetIsolate();
+        PerSocketData *perSocketData = (PerSocketData *) ws->getUserData();
+
+        uint32_t index = args[0]->Uint32Value(isolate->GetCurrentContext()).ToChecked();
+        if (!perSocketData->slotSchema || index >= perSocketData->slotSchema->slots.size()) {
+            args.GetReturnValue().Set(isolate->ThrowException(v8::Exception::Error(String::NewFromUtf8(isolate, "Slot index out of range of the slots of this behavior.", NewStringType::kNormal).ToLocalChecked())));
+            return nullptr;
+        }
+        return &perSocketData->slotSchema->slots[index];
+    }
+
+    /* Takes index, returns number or ArrayBuffer copy */
+    template <bool SSL>
+    static void uWS_WebSocket_getSlot(const FunctionCallbackInfo<Value> &args) {
+        Isolate *isolate = args.GetIsolate();
+        auto *ws = getWebSocket<SSL>(args);
+        if (ws) {
+            const SlotSchema::Slot *slot = getSlot(args, ws);
+            if (!slot) {
+                return;
+            }
+
+            char *data = ((PerSocketData *) ws->getUserData())->slots + slot->offset;
+            switch (slot->type) {
+            case SlotSchema::INT32:
+                args.GetReturnValue().Set(Integer::New(isolate, *(int32_t *) data));
+                break;
+            case SlotSchema::FLOAT64:
+                args.GetReturnValue().Set(Number::New(isolate, *(double *) data));
+                break;
+            case SlotSchema::BYTES:
+                args.GetReturnValue().Set(ArrayBuffer_NewCopy(isolate, data + 4, *(uint32_t *) data));
+                break;
+            }
+        }
+    }
+
+    /* Takes index, value. Returns this */
+    template <bool SSL>
+    static void uWS_WebSocket_setSlot(const FunctionCallbackInfo<Value> &args) {
+        Isolate *isolate = args.GetIsolate();
+        auto *ws = getWebSocket<SSL>(args);
+        if (ws) {
+            const SlotSchema::Slot *slot = getSlot(args, ws);
+            if (!slot) {
+                return;
+            }
+
+            char *data = ((PerSocketData *) ws->getUserData())->slots + slot->offset;
+            switch (slot->type) {
+            case SlotSchema::INT32:
+                *(int32_t *) data = args[1]->Int32Value(isolate->GetCurrentContext()).ToChecked();
+                break;
+            case SlotSchema::FLOAT64:
+                *(double *) data = args[1]->NumberValue(isolate->GetCurrentContext()).ToChecked();
+                break;
+            case SlotSchema::BYTES: {
+                NativeString<true> value(isolate, args[1]);
+                if (value.isInvalid(args)) {
+                    return;
+                }
+                if (value.getString().length() > slot->capacity) {
+                    args.GetReturnValue().Set(isolate->ThrowException(v8::Exception::Error(String::NewFromUtf8(isolate, "Value exceeds the capacity of the slot.", NewStringType::kNormal).ToLocalChecked())));
+                    return;
+                }
+                *(uint32_t *) data = (uint32_t) value.getString().length();
+                memcpy(data + 4, value.getString().data(), value.getString().length());
+                break;
+            }
+            }
+
+            args.GetReturnValue().Set(args.This());
+        }
+    }
+
+    /* Takes ArrayBuffer, file descriptor or pull function, options and callback. Returns false if a stream is already going */
+    template <bool SSL>
+    static void uWS_WebSocket_sendStream(const FunctionCallbackInfo<Value> &args) {
+        Isolate *isolate = args.GetIsolate();
+        auto *ws = getWebSocket<SSL>(args);
+        if (ws) {
+            if (missingArguments(1, args)) {
+                return;
+            }
+
+            if (sendStreams.contains(ws)) {
+                args.GetReturnValue().Set(Boolean::New(isolate, false));
+                return;
+            }
+
+            SendStream sendStream;
+            sendStream.fragmentSize = 64 * 1024;
+            sendStream.opCode = uWS::OpCode::BINARY;
+            sendStream.compress = false;
+
+            /* fragmentSize, watermark, isBinary, compress */
+            uint32_t watermark = 0;
+            if (args[1]->IsObject()) {
+                Local<Object> options = Local<Object>::Cast(args[1]);
+
+                Local<Value> fragmentSize = options->Get(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "fragmentSize", NewStringType::kNormal).ToLocalChecked()).ToLocalChecked();
+                if (!fragmentSize->IsUndefined()) {
+                    sendStream.fragmentSize = std::max<uint32_t>(1, fragmentSize->Uint32Value(isolate->GetCurrentContext()).ToChecked());
+                }
+                Local<Value> watermarkValue = options->Get(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "watermark", NewStringType::kNormal).ToLocalChecked()).ToLocalChecked();
+                if (!watermarkValue->IsUndefined()) {
+                    watermark = watermarkValue->Uint32Value(isolate->GetCurrentContext()).ToChecked();
+                }
+                Local<Value> isBinary = options->Get(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "isBinary", NewStringType::kNormal).ToLocalChecked()).ToLocalChecked();
+                if (!isBinary->IsUndefined()) {
+                    sendStream.opCode = isBinary->BooleanValue(isolate) ? uWS::OpCode::BINARY : uWS::OpCode::TEXT;
+                }
+                sendStream.compress = options->Get(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "compress", NewStringType::kNormal).ToLocalChecked()).ToLocalChecked()->BooleanValue(isolate);
+            }
+            sendStream.watermark = watermark ? watermark : sendStream.fragmentSize;
+
+            if (args[0]->IsFunction()) {
+                sendStream.pull.Reset(isolate, Local<Function>::Cast(args[0]));
+            } else if (args[0]->IsNumber()) {
+                /* The file descriptor stays open and owned by the caller */
+                sendStream.fd = args[0]->Int32Value(isolate->GetCurrentContext()).ToChecked();
+                struct stat st;
+                if (fstat(sendStream.fd, &st) != 0) {
+                    args.GetReturnValue().Set(isolate->ThrowException(v8::Exception::Error(String::NewFromUtf8(isolate, "sendStream was passed an invalid file descriptor.", NewStringType::kNormal).ToLocalChecked())));
+                    return;
+                }
+                sendStream.length = (uint64_t) st.st_size;
+            } else if (args[0]->IsArrayBuffer()) {
+                Local<ArrayBuffer> arrayBuffer = Local<ArrayBuffer>::Cast(args[0]);
+                sendStream.backingStore = arrayBuffer->GetBackingStore();
+                sendStream.data = (const char *) sendStream.backingStore->Data();
+                sendStream.length = arrayBuffer->ByteLength();
+            } else if (args[0]->IsArrayBufferView()) {
+                Local<ArrayBufferView> arrayBufferView = Local<ArrayBufferView>::Cast(args[0]);
+                sendStream.backingStore = arrayBufferView->Buffer()->GetBackingStore();
+                sendStream.data = (const char *) sendStream.backingStore->Data() + arrayBufferView->ByteOffset();
+                sendStream.length = arrayBufferView->ByteLength();
+            } else {
+                args.GetReturnValue().Set(isolate->ThrowException(v8::Exception::Error(String::NewFromUtf8(isolate, "sendStream requires an ArrayBuffer, ArrayBufferView, file descriptor or function.", NewStringType::kNormal).ToLocalChecked())));
+                return;
+            }
+
+            if (!args[2]->IsNullOrUndefined()) {
+                Callback checkedCallback(isolate, args[2]);
+                if (checkedCallback.isInvalid(args)) {
+                    return;
+                }
+                sendStream.cb = checkedCallback.getFunction();
+            }
+
+            PerSocketData *perSocketData = (PerSocketData *) ws->getUserData();
+            sendStream.app = perSocketData->app;
+            sendStream.maxBackpressure = perSocketData->maxBackpressure;
+
+            /* Closing ws meanwhile ends the stream as failed */
+            sendStreams.emplace(ws, std::move(sendStream));
+            takeSendStreamTopics(ws);
+            pumpSendStream(isolate, ws);
+
+            args.GetReturnValue().Set(Boolean::New(isolate, true));
+        }
+    }
+
+    /* Takes array of WebSockets, message, isBinary, compress. Returns Uint8Array of sendStatus by WebSocket */
+    static void uWS_sendTo(const FunctionCallbackInfo<Value> &args) {
+        Isolate *isolate = args.GetIsolate();
+        PerContextData *perContextData = (PerContextData *) Local<External>::Cast(args.Data())->Value();
+
+        if (missingArguments(2, args)) {
+            return;
+        }
+
+        if (!args[0]->IsArray()) {
+            args.GetReturnValue().Set(isolate->ThrowException(v8::Exception::Error(String::NewFromUtf8(isolate, "sendTo requires an array of WebSockets.", NewStringType::kNormal).ToLocalChecked())));
+            return;
+        }
+
+        Local<Array> webSockets = Local<Array>::Cast(args[0]);
+
+        /* The message is converted once for all recipients */
+        NativeString<true> nativeMessage(isolate, args[1]);
+        if (nativeMessage.isInvalid(args)) {
+            return;
+        }
+        std::string_view message = nativeMessage.getString();
+        uWS::OpCode opCode = args[2]->BooleanValue(isolate) ? uWS::OpCode::BINARY : uWS::OpCode::TEXT;
+        bool compress = args[3]->BooleanValue(isolate);
+
+        Local<FunctionTemplate> wsClasses[2] = {perContextData->wsClass[0].Get(isolate), perContextData->wsClass[1].Get(isolate)};
+
+        uint32_t length = webSockets->Length();
+        Local<ArrayBuffer> sendStatusArrayBuffer = ArrayBuffer::New(isolate, length);
+        uint8_t *sendStatuses = (uint8_t *) sendStatusArrayBuffer->GetBackingStore()->Data();
+
+        for (uint32_t i = 0; i < length; i++) {
+            Local<Value> wsValue = webSockets->Get(isolate->GetCurrentContext(), i).ToLocalChecked();
+
+            /* Sockets closed by earlier sends in this loop are seen as closed here */
+            if (wsClasses[0]->HasInstance(wsValue)) {
+                auto *ws = (uWS::WebSocket<false, true, PerSocketData> *) getInternalPointer(Local<Object>::Cast(wsValue));
+                sendStatuses[i] = ws ? sendBehindSendStream(ws, message, opCode, shouldCompress(ws, message, compress)) : uWS::WebSocket<false, true, PerSocketData>::DROPPED;
+            } else if (wsClasses[1]->HasInstance(wsValue)) {
+                auto *ws = (uWS::WebSocket<true, true, PerSocketData> *) getInternalPointer(Local<Object>::Cast(wsValue));
+                sendStatuses[i] = ws ? sendBehindSendStream(ws, message, opCode, shouldCompress(ws, message, compress)) : uWS::WebSocket<true, true, PerSocketData>::DROPPED;
+            } else {
+                args.GetReturnValue().Set(isolate->ThrowException(v8::Exception::Error(String::NewFromUtf8(isolate, "sendTo requires an array of WebSockets.", NewStringType::kNormal).ToLocalChecked())));
+                return;
+            }
+        }
+
+        args.GetReturnValue().Set(Uint8Array::New(sendStatusArrayBuffer, 0, length));
+    }
+
     /* Takes topic string, returns bool */
     template <bool SSL>
     static void uWS_WebSocket_isSubscribed(const FunctionCallbackInfo<Value> &args) {
@@ -267,7 +651,13 @@ struct WebSocketWrapper {
                 return;
             }
 
-            bool subscribed = ws->isSubscribed(topic.getString());
+            bool subscribed;
+            if (WildcardTopics::isWildcard(topic.getString())) {
+                AppWildcardTopics *wildcardTopics = getAppWildcardTopics(((PerSocketData *) ws->getUserData())->app);
+                subscribed = wildcardTopics && wildcardTopics->topics.isSubscribed(ws, topic.getString());
+            } else {
+                subscribed = ws->isSubscribed(topic.getString()) || isSubscribedBySendStream(ws, topic.getString());
+            }
 
             args.GetReturnValue().Set(Boolean::New(isolate, subscribed));
         }
@@ -307,6 +697,29 @@ struct WebSocketWrapper {
         }
     }
 
+    /* Returns the number of topics and wildcard patterns, without listing them */
+    template <bool SSL>
+    static void uWS_WebSocket_topicCount(const FunctionCallbackInfo<Value> &args) {
+        Isolate *isolate = args.GetIsolate();
+        auto *ws = getWebSocket<SSL>(args);
+        if (ws) {
+            uint32_t topicCount = 0;
+            ws->iterateTopics([&topicCount](std::string_view) {
+                topicCount++;
+            });
+            if (SendStream *sendStream = getSendStream(ws)) {
+                topicCount += (uint32_t) sendStream->topics.size();
+            }
+            if (AppWildcardTopics *wildcardTopics = getAppWildcardTopics(((PerSocketData *) ws->getUserData())->app)) {
+                wildcardTopics->topics.forEachPattern(ws, [&topicCount](std::string_view) {
+                    topicCount++;
+                });
+            }
+
+            args.GetReturnValue().Set(Integer::NewFromUnsigned(isolate, topicCount));
+        }
+    }
+
     /* This one is wrapped instead of iterateTopics as JS-people will put their hands in wood chipper for sure. */
     template <bool SSL>
     static void uWS_WebSocket_getTopics(const FunctionCallbackInfo<Value> &args) {
@@ -316,11 +729,23 @@ struct WebSocketWrapper {
 
             Local<Array> topicsArray = Array::New(isolate, 0);
 
-            ws->iterateTopics([&topicsArray, isolate](std::string_view topic) {
+            auto addTopic = [&topicsArray, isolate](std::string_view topic) {
                 Local<String> topicString = String::NewFromUtf8(isolate, topic.data(), NewStringType::kNormal, topic.length()).ToLocalChecked();
 
                 topicsArray->Set(isolate->GetCurrentContext(), topicsArray->Length(), topicString).IsNothing();
-            });
+            };
+
+            ws->iterateTopics(addTopic);
+            if (SendStream *sendStream = getSendStream(ws)) {
+                for (std::string &topic : sendStream->topics) {
+                    addTopic(topic);
+                }
+            }
+
+            /* Followed by wildcard patterns */
+            if (AppWildcardTopics *wildcardTopics = getAppWildcardTopics(((PerSocketData *) ws->getUserData())->app)) {
+                wildcardTopics->topics.forEachPattern(ws, addTopic);
+            }
 
             args.GetReturnValue().Set(topicsArray);
         }
@@ -338,8 +763,9 @@ static uint32_t uWS_WebSocket_send_fast_string(v8::Local<v8::Object> receiver,
                                                bool isBinary, bool compress) {
     auto *ws = (uWS::WebSocket<SSL, true, PerSocketData> *) getInternalPointer(receiver);//->GetAlignedPointerFromInternalField(0);
     if (!ws) return 0;
-    return ws->send(std::string_view(message.data, message.length),
-                    isBinary ? uWS::OpCode::BINARY : uWS::OpCode::TEXT, compress);
+    std::string_view messageView(message.data, message.length);
+    return sendBehindSendStream(ws, messageView,
+                                isBinary ? uWS::OpCode::BINARY : uWS::OpCode::TEXT, shouldCompress(ws, messageView, compress));
 }
 
 // Version B: Handles ArrayBuffer/TypedArray
@@ -366,12 +792,12 @@ static uint32_t uWS_WebSocket_send_fast_buffer(v8::Local<v8::Object> receiver,
         return 0; 
     }
     
-    return ws->send(std::string_view(data, length),
-                    isBinary ? uWS::OpCode::BINARY : uWS::OpCode::TEXT, compress);
+    return sendBehindSendStream(ws, std::string_view(data, length),
+                                isBinary ? uWS::OpCode::BINARY : uWS::OpCode::TEXT, shouldCompress(ws, std::string_view(data, length), compress));
 }
 
     template <bool SSL>
-    static Local<Object> init(Isolate *isolate) {
+    static Local<Object> init(Isolate *isolate, UniquePersistent<FunctionTemplate> &wsClass) {
         Local<FunctionTemplate> wsTemplateLocal = FunctionTemplate::New(isolate);
         if (SSL) {
             wsTemplateLocal->SetClassName(String::NewFromUtf8(isolate, "uWS.SSLWebSocket", NewStringType::kNormal).ToLocalChecked());
@@ -380,6 +806,9 @@ static uint32_t uWS_WebSocket_send_fast_buffer(v8::Local<v8::Object> receiver,
         }
         wsTemplateLocal->InstanceTemplate()->SetInternalFieldCount(1);
 
+        /* WebSockets are clones of the one instance we return, so they all pass HasInstance */
+        wsClass.Reset(isolate, wsTemplateLocal);
+
         /* Register our functions */
         wsTemplateLocal->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "sendFirstFragment", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_WebSocket_sendFirstFragment<SSL>));
         wsTemplateLocal->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "sendFragment", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_WebSocket_sendFragment<SSL>));
@@ -388,9 +817,14 @@ static uint32_t uWS_WebSocket_send_fast_buffer(v8::Local<v8::Object> receiver,
         wsTemplateLocal->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "getUserData", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_WebSocket_getUserData<SSL>));
         static v8::CFunction fast_send = v8::CFunction::Make(uWS_WebSocket_send_fast_buffer<SSL>);
         wsTemplateLocal->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "send", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_WebSocket_send<SSL>/*, Local<Value>(), Local<Signature>(), 0, ConstructorBehavior::kThrow, SideEffectType::kHasSideEffect, &fast_send*/));
+        wsTemplateLocal->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "getSlot", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_WebSocket_getSlot<SSL>));
+        wsTemplateLocal->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "setSlot", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_WebSocket_setSlot<SSL>));
+        wsTemplateLocal->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "sendStream", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_WebSocket_sendStream<SSL>));
+        wsTemplateLocal->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "sendMany", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_WebSocket_sendMany<SSL>));
         wsTemplateLocal->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "end", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_WebSocket_end<SSL>));
         wsTemplateLocal->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "close", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_WebSocket_close<SSL>));
         wsTemplateLocal->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "getBufferedAmount", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_WebSocket_getBufferedAmount<SSL>));
+        wsTemplateLocal->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "getRtt", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_WebSocket_getRtt<SSL>));
         wsTemplateLocal->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "getRemoteAddress", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_WebSocket_getRemoteAddress<SSL>));
         wsTemplateLocal->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "subscribe", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_WebSocket_subscribe<SSL>));
         wsTemplateLocal->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "unsubscribe", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_WebSocket_unsubscribe<SSL>));
@@ -400,9 +834,11 @@ static uint32_t uWS_WebSocket_send_fast_buffer(v8::Local<v8::Object> receiver,
         wsTemplateLocal->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "getRemoteAddressAsText", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_WebSocket_getRemoteAddressAsText<SSL>));
         wsTemplateLocal->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "getRemotePort", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_WebSocket_getRemotePort<SSL>));
         wsTemplateLocal->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "isSubscribed", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_WebSocket_isSubscribed<SSL>));
+        wsTemplateLocal->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "setTimer", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_WebSocket_setTimer<SSL>));
 
         /* This one does not exist in C++ */
         wsTemplateLocal->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "getTopics", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_WebSocket_getTopics<SSL>));
+        wsTemplateLocal->PrototypeTemplate()->Set(String::NewFromUtf8(isolate, "topicCount", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_WebSocket_topicCount<SSL>));
 
         /* Create the template */
         Local<Object> wsObjectLocal = wsTemplateLocal->GetFunction(isolate->GetCurrentContext()).ToLocalChecked()->NewInstance(isolate->GetCurrentContext()).ToLocalChecked();
@@ -0,0 +1,283 @@
+/*
+ * Authored by Alex Hultman, 2018-2026.
+ * Intellectual property of third-party.
+
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ADDON_WILDCARDTOPICS_H
+#define ADDON_WILDCARDTOPICS_H
+
+#include "App.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/* MQTT style wildcard subscriptions, where topic levels are separated by / and a level of + matches any one
+ * level, while a last level of # matches any number of levels (also none). Patterns live in a trie by level
+ * and every concrete topic published caches the subscribers it matched until subscriptions change.
+ * Exact topics are left to the topic tree of µWS. */
+struct WildcardTopics {
+private:
+    struct Node {
+        std::unordered_map<std::string, std::unique_ptr<Node>> children;
+        std::vector<void *> subscribers;
+    };
+
+    Node root;
+
+    /* Patterns of every subscriber, for getTopics and unsubscribing on close */
+    std::unordered_map<void *, std::vector<std::string>> patterns;
+
+    /* Matched subscribers by concrete topic */
+    std::unordered_map<std::string, std::vector<void *>> fanoutCache;
+    static constexpr size_t MAX_CACHED_TOPICS = 4096;
+
+    template <class F>
+    static void forEachLevel(std::string_view topic, F f) {
+        while (true) {
+            size_t slash = topic.find('/');
+            f(topic.substr(0, slash));
+            if (slash == std::string_view::npos) {
+                return;
+            }
+            topic.remove_prefix(slash + 1);
+        }
+    }
+
+    static void addAll(std::vector<void *> &matches, const std::vector<void *> &subscribers) {
+        matches.insert(matches.end(), subscribers.begin(), subscribers.end());
+    }
+
+    void match(Node *node, std::string_view remaining, bool end, std::vector<void *> &matches) {
+        /* # matches all remaining levels, also none */
+        auto hash = node->children.find("#");
+        if (hash != node->children.end()) {
+            addAll(matches, hash->second->subscribers);
+        }
+
+        if (end) {
+            addAll(matches, node->subscribers);
+            return;
+        }
+
+        size_t slash = remaining.find('/');
+        std::string_view level = remaining.substr(0, slash);
+        std::string_view rest = slash == std::string_view::npos ? std::string_view() : remaining.substr(slash + 1);
+        bool last = slash == std::string_view::npos;
+
+        auto exact = node->children.find(std::string(level));
+        if (exact != node->children.end()) {
+            match(exact->second.get(), rest, last, matches);
+        }
+        auto plus = node->children.find("+");
+        if (plus != node->children.end()) {
+            match(plus->second.get(), rest, last, matches);
+        }
+    }
+
+    /* Removes the subscriber and prunes the nodes left empty */
+    void removeFromTrie(void *subscriber, std::string_view pattern) {
+        std::vector<std::pair<Node *, std::string>> path;
+        Node *node = &root;
+        forEachLevel(pattern, [&](std::string_view level) {
+            path.emplace_back(node, level);
+            node = node->children[std::string(level)].get();
+        });
+        std::erase(node->subscribers, subscriber);
+        for (auto parent = path.rbegin(); parent != path.rend(); parent++) {
+            Node *child = parent->first->children[parent->second].get();
+            if (child->subscribers.size() || child->children.size()) {
+                break;
+            }
+            parent->first->children.erase(parent->second);
+        }
+    }
+
+    void changed() {
+        fanoutCache.clear();
+        generation++;
+    }
+
+public:
+    /* Bumped on every change of subscriptions */
+    unsigned long long generation = 0;
+
+    /* Only patterns with a level of + or a last level of # are wildcards, anything else is an exact topic */
+    static bool isWildcard(std::string_view topic) {
+        bool wildcard = false, valid = true, afterHash = false;
+        forEachLevel(topic, [&](std::string_view level) {
+            if (afterHash) {
+                valid = false;
+            }
+            if (level == "+") {
+                wildcard = true;
+            } else if (level == "#") {
+                wildcard = afterHash = true;
+            } else if (level.find_first_of("+#") != std::string_view::npos) {
+                valid = false;
+            }
+        });
+        return wildcard && valid;
+    }
+
+    bool empty() {
+        return patterns.empty();
+    }
+
+    bool isSubscribed(void *subscriber, std::string_view pattern) {
+        auto it = patterns.find(subscriber);
+        return it != patterns.end() && std::find(it->second.begin(), it->second.end(), pattern) != it->second.end();
+    }
+
+    /* Returns false if already subscribed */
+    bool subscribe(void *subscriber, std::string_view pattern) {
+        if (isSubscribed(subscriber, pattern)) {
+            return false;
+        }
+
+        Node *node = &root;
+        forEachLevel(pattern, [&node](std::string_view level) {
+            std::unique_ptr<Node> &child = node->children[std::string(level)];
+            if (!child) {
+                child = std::make_unique<Node>();
+            }
+            node = child.get();
+        });
+        node->subscribers.push_back(subscriber);
+        patterns[subscriber].emplace_back(pattern);
+
+        changed();
+        return true;
+    }
+
+    /* Returns false if not subscribed */
+    bool unsubscribe(void *subscriber, std::string_view pattern) {
+        auto it = patterns.find(subscriber);
+        if (it == patterns.end()) {
+            return false;
+        }
+        auto subscribedPattern = std::find(it->second.begin(), it->second.end(), pattern);
+        if (subscribedPattern == it->second.end()) {
+            return false;
+        }
+        it->second.erase(subscribedPattern);
+        if (it->second.empty()) {
+            patterns.erase(it);
+        }
+
+        removeFromTrie(subscriber, pattern);
+        changed();
+        return true;
+    }
+
+    /* Called when the subscriber closes */
+    void unsubscribeAll(void *subscriber) {
+        auto it = patterns.find(subscriber);
+        if (it == patterns.end()) {
+            return;
+        }
+        for (std::string &pattern : it->second) {
+            removeFromTrie(subscriber, pattern);
+        }
+        patterns.erase(it);
+        changed();
+    }
+
+    template <class F>
+    void forEachPattern(void *subscriber, F f) {
+        auto it = patterns.find(subscriber);
+        if (it != patterns.end()) {
+            for (std::string &pattern : it->second) {
+                f(std::string_view(pattern));
+            }
+        }
+    }
+
+    /* Returns every subscriber of a pattern matching the concrete topic once. Valid until subscriptions change */
+    const std::vector<void *> &match(std::string_view topic) {
+        auto cached = fanoutCache.find(std::string(topic));
+        if (cached != fanoutCache.end()) {
+            return cached->second;
+        }
+
+        if (fanoutCache.size() >= MAX_CACHED_TOPICS) {
+            fanoutCache.clear();
+        }
+
+        std::vector<void *> matches;
+        match(&root, topic, false, matches);
+        std::sort(matches.begin(), matches.end());
+        matches.erase(std::unique(matches.begin(), matches.end()), matches.end());
+
+        return fanoutCache.emplace(std::string(topic), std::move(matches)).first->second;
+    }
+
+    bool isSubscriber(void *subscriber) {
+        return patterns.contains(subscriber);
+    }
+};
+
+/* Wildcard subscriptions of every app on this thread, with how to send to its WebSockets */
+struct AppWildcardTopics {
+    WildcardTopics topics;
+    /* Returns false if dropped */
+    bool (*send)(void *ws, std::string_view message, uWS::OpCode opCode, bool compress);
+    bool (*isSubscribed)(void *ws, std::string_view topic);
+    /* Sends what the topic tree of app has buffered */
+    void (*drain)(void *app);
+};
+
+thread_local std::unordered_map<void *, AppWildcardTopics> appWildcardTopics;
+
+/* Returns the wildcard subscriptions of app, if it has any */
+static inline AppWildcardTopics *getAppWildcardTopics(void *app) {
+    if (appWildcardTopics.empty()) {
+        return nullptr;
+    }
+    auto it = appWildcardTopics.find(app);
+    return it == appWildcardTopics.end() || it->second.topics.empty() ? nullptr : &it->second;
+}
+
+/* Sends a message published under a concrete topic to the wildcard subscribers of app matching it,
+ * skipping the publisher and subscribers of the exact topic (which get it from µWS). Returns how many it was sent to */
+static inline unsigned int publishToWildcardSubscribers(void *app, std::string_view topic, std::string_view message, uWS::OpCode opCode, bool compress, void *publisher = nullptr) {
+    AppWildcardTopics *wildcardTopics = getAppWildcardTopics(app);
+    if (!wildcardTopics) {
+        return 0;
+    }
+
+    /* Regular publishes made before this one go out first */
+    wildcardTopics->drain(app);
+
+    /* Sending may call into JS (dropped) and change subscriptions, or close subscribers */
+    std::vector<void *> subscribers = wildcardTopics->topics.match(topic);
+    unsigned long long generation = wildcardTopics->topics.generation;
+    unsigned int delivered = 0;
+    for (void *ws : subscribers) {
+        if (ws == publisher || wildcardTopics->isSubscribed(ws, topic)) {
+            continue;
+        }
+        if (generation != wildcardTopics->topics.generation && !wildcardTopics->topics.isSubscriber(ws)) {
+            continue;
+        }
+        delivered += wildcardTopics->send(ws, message, opCode, compress);
+    }
+    return delivered;
+}
+
+#endif
@@ -27,6 +27,7 @@
 using namespace v8;
 
 #include "Utilities.h"
+#include "TimersWrapper.h"
 #include "WebSocketWrapper.h"
 #include "HttpResponseWrapper.h"
 #include "HttpRequestWrapper.h"
@@ -109,44 +110,6 @@ void uWS_getParts(const FunctionCallbackInfo<Value> &args) {
     /* We'll return undefined on error */
 }
 
-/* Faster setTimeout, clearTimeout */
-
-//#include "FastTimers.h"
-
-//UniquePersistent<Function> timerCallbacksJS[1000];
-
-void uWS_arm(const FunctionCallbackInfo<Value> &args) {
-
-    /* integer */
-
-    uint32_t ms = Local<Integer>::Cast(args[0])->Value();
-
-
-    //unsigned int timer = setTimeout_(nullptr, 1000);
-}
-
-void uWS_setTimeout(const FunctionCallbackInfo<Value> &args) {
-
-    /* Function, integer */
-
-    //unsigned int timer = setTimeout_(nullptr, 1000);
-
-    //timerCallbacksJS[timer].Reset(args.GetIsolate(), Local<Function>::Cast(args[0]));
-
-    //args.GetReturnValue().Set(Integer::New(args.GetIsolate(), timer));
-}
-
-void uWS_clearTimeout(const FunctionCallbackInfo<Value> &args) {
-
-    /* Integer */
-
-    uint32_t timer = Local<Integer>::Cast(args[0])->Value();
-
-    //clearTimeout_(timer);
-
-    //timerCallbacksJS[timer].Reset();
-}
-
 /* Pass various undocumented configs */
 void uWS_cfg(const FunctionCallbackInfo<Value> &args) {
     NativeString key(args.GetIsolate(), args[0]);
@@ -181,6 +144,65 @@ std::unordered_map<std::string, std::unordered_map<std::string, std::string>> kv
 std::unordered_map<std::string, std::unordered_map<std::string, uint32_t>> kvStoreInteger;
 std::mutex kvMutex;
 
+/* Cross-thread change notifications for the KV store */
+#include "LoopQueue.h"
+#include <algorithm>
+#include <atomic>
+#include <optional>
+#include <unordered_set>
+
+struct KvChange {
+    uint32_t watcher;
+    /* Changed key, or nullopt when the whole collection was deleted */
+    std::optional<std::string> key;
+};
+
+struct KvWatcher {
+    uint32_t id;
+    std::string collection;
+    std::string prefix;
+    LoopQueue<KvChange> *queue;
+};
+
+/* The registry is shared by all threads, mutations only take its lock if anyone is watching */
+std::vector<KvWatcher> kvWatchers;
+std::mutex kvWatchMutex;
+std::atomic<size_t> kvWatcherCount = 0;
+uint32_t kvWatcherIds = 0;
+
+/* Every watching thread has one queue drained on its own loop */
+thread_local LoopQueue<KvChange> *kvWatchQueue = nullptr;
+thread_local std::unordered_map<uint32_t, UniquePersistent<Function>> kvWatchCallbacks;
+
+/* Pushes the change to every thread watching a matching prefix, key is nullptr for collection deletes */
+void kvNotify(std::string_view collection, const std::string *key) {
+    if (!kvWatcherCount.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(kvWatchMutex);
+    for (KvWatcher &watcher : kvWatchers) {
+        if (watcher.collection != collection || (key && !key->starts_with(watcher.prefix))) {
+            continue;
+        }
+        watcher.queue->push({watcher.id, key ? std::optional<std::string>(*key) : std::nullopt});
+    }
+}
+
+/* Called before freeing the loop of this thread */
+void kvUnwatchAll() {
+    if (!kvWatchQueue) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(kvWatchMutex);
+    std::erase_if(kvWatchers, [](KvWatcher &watcher) {
+        return watcher.queue == kvWatchQueue;
+    });
+    kvWatcherCount = kvWatchers.size();
+    kvWatchCallbacks.clear();
+}
+
 // getString(key, collection)
 void uWS_getString(const FunctionCallbackInfo<Value> &args) {
     NativeString key(args.GetIsolate(), args[0]);
@@ -213,7 +235,10 @@ void uWS_setString(const FunctionCallbackInfo<Value> &args) {
         return;
     }
 
-    kvStoreString[std::string(collection.getString())][std::string(key.getString())] = value.getString();
+    std::string keyString(key.getString());
+    kvStoreString[std::string(collection.getString())][keyString] = value.getString();
+
+    kvNotify(collection.getString(), &keyString);
 }
 
 void uWS_getInteger(const FunctionCallbackInfo<Value> &args) {
@@ -245,7 +270,10 @@ void uWS_setInteger(const FunctionCallbackInfo<Value> &args) {
         return;
     }
 
-    kvStoreInteger[std::string(collection.getString())][std::string(key.getString())] = value;
+    std::string keyString(key.getString());
+    kvStoreInteger[std::string(collection.getString())][keyString] = value;
+
+    kvNotify(collection.getString(), &keyString);
 }
 
 void uWS_incInteger(const FunctionCallbackInfo<Value> &args) {
@@ -261,7 +289,10 @@ void uWS_incInteger(const FunctionCallbackInfo<Value> &args) {
         return;
     }
 
-    uint32_t value = kvStoreInteger[std::string(collection.getString())][std::string(key.getString())] += change;
+    std::string keyString(key.getString());
+    uint32_t value = kvStoreInteger[std::string(collection.getString())][keyString] += change;
+
+    kvNotify(collection.getString(), &keyString);
 
     args.GetReturnValue().Set(Integer::New(args.GetIsolate(), value));
 }
@@ -315,7 +346,10 @@ void uWS_deleteString(const FunctionCallbackInfo<Value> &args) {
         return;
     }
 
-    kvStoreString[std::string(collection.getString())].erase(std::string(key.getString()));
+    std::string keyString(key.getString());
+    if (kvStoreString[std::string(collection.getString())].erase(keyString)) {
+        kvNotify(collection.getString(), &keyString);
+    }
 
     //args.GetReturnValue().Set(Integer::New(args.GetIsolate(), value));
 }
@@ -332,7 +366,10 @@ void uWS_deleteInteger(const FunctionCallbackInfo<Value> &args) {
         return;
     }
 
-    kvStoreInteger[std::string(collection.getString())].erase(std::string(key.getString()));
+    std::string keyString(key.getString());
+    if (kvStoreInteger[std::string(collection.getString())].erase(keyString)) {
+        kvNotify(collection.getString(), &keyString);
+    }
 
     //args.GetReturnValue().Set(Integer::New(args.GetIsolate(), value));
 }
@@ -344,7 +381,9 @@ void uWS_deleteStringCollection(const FunctionCallbackInfo<Value> &args) {
         return;
     }
 
-    kvStoreString.erase(std::string(collection.getString()));
+    if (kvStoreString.erase(std::string(collection.getString()))) {
+        kvNotify(collection.getString(), nullptr);
+    }
 
     //args.GetReturnValue().Set(integerKeys);
 }
@@ -356,7 +395,9 @@ void uWS_deleteIntegerCollection(const FunctionCallbackInfo<Value> &args) {
         return;
     }
 
-    kvStoreInteger.erase(std::string(collection.getString()));
+    if (kvStoreInteger.erase(std::string(collection.getString()))) {
+        kvNotify(collection.getString(), nullptr);
+    }
 
     //args.GetReturnValue().Set(integerKeys);
 }
@@ -369,6 +410,105 @@ void uWS_unlock(const FunctionCallbackInfo<Value> &args) {
     kvMutex.unlock();
 }
 
+// watch(collection, prefix, cb) returns watcher id, cb receives an array of changed keys (null for deleted collection)
+void uWS_watch(const FunctionCallbackInfo<Value> &args) {
+    Isolate *isolate = args.GetIsolate();
+
+    NativeString collection(isolate, args[0]);
+    if (collection.isInvalid(args)) {
+        return;
+    }
+
+    NativeString prefix(isolate, args[1]);
+    if (prefix.isInvalid(args)) {
+        return;
+    }
+
+    Callback checkedCallback(isolate, args[2]);
+    if (checkedCallback.isInvalid(args)) {
+        return;
+    }
+
+    /* Lazily create the queue of this thread, delivering one JS call per watcher and batch */
+    if (!kvWatchQueue) {
+        kvWatchQueue = new LoopQueue<KvChange>(uWS::Loop::get(), [isolate](std::vector<KvChange> &changes) {
+            HandleScope hs(isolate);
+
+            /* Group changes per watcher in order, skipping repeated keys within the batch */
+            struct Batch {
+                uint32_t watcher;
+                Local<Array> keys;
+                std::unordered_set<std::string_view> seen;
+            };
+            std::vector<Batch> batches;
+            for (KvChange &change : changes) {
+                if (!kvWatchCallbacks.contains(change.watcher)) {
+                    continue;
+                }
+
+                auto batch = std::find_if(batches.begin(), batches.end(), [&change](Batch &batch) {
+                    return batch.watcher == change.watcher;
+                });
+                if (batch == batches.end()) {
+                    batch = batches.insert(batches.end(), {change.watcher, Array::New(isolate, 0), {}});
+                }
+
+                Local<Value> key = Null(isolate);
+                if (change.key) {
+                    if (!batch->seen.emplace(*change.key).second) {
+                        continue;
+                    }
+                    key = String::NewFromUtf8(isolate, change.key->data(), NewStringType::kNormal, change.key->length()).ToLocalChecked();
+                }
+                batch->keys->Set(isolate->GetCurrentContext(), batch->keys->Length(), key).IsNothing();
+            }
+
+            for (Batch &batch : batches) {
+                /* A previous callback in this batch may have unwatched */
+                auto callback = kvWatchCallbacks.find(batch.watcher);
+                if (callback == kvWatchCallbacks.end()) {
+                    continue;
+                }
+                Local<Value> argv[] = {batch.keys};
+                CallJS(isolate, Local<Function>::New(isolate, callback->second), 1, argv);
+            }
+        });
+    }
+
+    uint32_t id;
+    {
+        std::lock_guard<std::mutex> lock(kvWatchMutex);
+        id = ++kvWatcherIds;
+        kvWatchers.push_back({id, std::string(collection.getString()), std::string(prefix.getString()), kvWatchQueue});
+        kvWatcherCount = kvWatchers.size();
+    }
+    kvWatchCallbacks.emplace(id, checkedCallback.getFunction());
+
+    args.GetReturnValue().Set(Integer::NewFromUnsigned(isolate, id));
+}
+
+// unwatch(id), only valid on the thread that called watch
+void uWS_unwatch(const FunctionCallbackInfo<Value> &args) {
+    Isolate *isolate = args.GetIsolate();
+
+    if (!args[0]->IsNumber()) {
+        args.GetReturnValue().Set(isolate->ThrowException(v8::Exception::Error(String::NewFromUtf8(isolate, "unwatch takes a watcher id returned by watch.", NewStringType::kNormal).ToLocalChecked())));
+        return;
+    }
+
+    uint32_t id = args[0]->Uint32Value(isolate->GetCurrentContext()).ToChecked();
+
+    if (!kvWatchCallbacks.erase(id)) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(kvWatchMutex);
+    std::erase_if(kvWatchers, [id](KvWatcher &watcher) {
+        return watcher.id == id;
+    });
+    kvWatcherCount = kvWatchers.size();
+}
+
 PerContextData *Main(Isolate *isolate, Local<Object> exports) {
 
     /* Init the template objects, SSL and non-SSL, store it in per context data */
@@ -380,8 +520,8 @@ PerContextData *Main(Isolate *isolate, Local<Object> exports) {
     perContextData->resTemplate[1].Reset(isolate, HttpResponseWrapper::init<1>(isolate));
     perContextData->resTemplate[2].Reset(isolate, HttpResponseWrapper::init<2>(isolate));
     perContextData->resTemplate[3].Reset(isolate, HttpResponseWrapper::init<3>(isolate));
-    perContextData->wsTemplate[0].Reset(isolate, WebSocketWrapper::init<0>(isolate));
-    perContextData->wsTemplate[1].Reset(isolate, WebSocketWrapper::init<1>(isolate));
+    perContextData->wsTemplate[0].Reset(isolate, WebSocketWrapper::init<0>(isolate, perContextData->wsClass[0]));
+    perContextData->wsTemplate[1].Reset(isolate, WebSocketWrapper::init<1>(isolate, perContextData->wsClass[1]));
 
     /* Refer to per context data via External */
     Local<External> externalPerContextData = External::New(isolate, perContextData);
@@ -390,6 +530,10 @@ PerContextData *Main(Isolate *isolate, Local<Object> exports) {
     exports->Set(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "App", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_App<uWS::App>, externalPerContextData)->GetFunction(isolate->GetCurrentContext()).ToLocalChecked()).ToChecked();
     exports->Set(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "SSLApp", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_App<uWS::SSLApp>, externalPerContextData)->GetFunction(isolate->GetCurrentContext()).ToLocalChecked()).ToChecked();
 
+    /* Publishes to the apps of all threads */
+    exports->Set(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "publish", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_publish, externalPerContextData)->GetFunction(isolate->GetCurrentContext()).ToLocalChecked()).ToChecked();
+    exports->Set(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "sendTo", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, WebSocketWrapper::uWS_sendTo, externalPerContextData)->GetFunction(isolate->GetCurrentContext()).ToLocalChecked()).ToChecked();
+
     /* H3 experimental */
     exports->Set(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "H3App", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_App<uWS::H3App>, externalPerContextData)->GetFunction(isolate->GetCurrentContext()).ToLocalChecked()).ToChecked();
 
@@ -407,9 +551,14 @@ PerContextData *Main(Isolate *isolate, Local<Object> exports) {
     exports->Set(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "deleteInteger", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_deleteInteger)->GetFunction(isolate->GetCurrentContext()).ToLocalChecked()).ToChecked();
     exports->Set(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "deleteStringCollection", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_deleteStringCollection)->GetFunction(isolate->GetCurrentContext()).ToLocalChecked()).ToChecked();
     exports->Set(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "deleteIntegerCollection", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_deleteIntegerCollection)->GetFunction(isolate->GetCurrentContext()).ToLocalChecked()).ToChecked();
+    exports->Set(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "watch", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_watch)->GetFunction(isolate->GetCurrentContext()).ToLocalChecked()).ToChecked();
+    exports->Set(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "unwatch", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_unwatch)->GetFunction(isolate->GetCurrentContext()).ToLocalChecked()).ToChecked();
 
     exports->Set(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "setTimeout", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_setTimeout)->GetFunction(isolate->GetCurrentContext()).ToLocalChecked()).ToChecked();
     exports->Set(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "clearTimeout", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_clearTimeout)->GetFunction(isolate->GetCurrentContext()).ToLocalChecked()).ToChecked();
+    exports->Set(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "setInterval", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_setInterval)->GetFunction(isolate->GetCurrentContext()).ToLocalChecked()).ToChecked();
+    exports->Set(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "clearInterval", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_clearTimeout)->GetFunction(isolate->GetCurrentContext()).ToLocalChecked()).ToChecked();
+    exports->Set(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "onExpired", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_onExpired)->GetFunction(isolate->GetCurrentContext()).ToLocalChecked()).ToChecked();
     exports->Set(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "arm", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_arm)->GetFunction(isolate->GetCurrentContext()).ToLocalChecked()).ToChecked();
 
     exports->Set(isolate->GetCurrentContext(), String::NewFromUtf8(isolate, "_cfg", NewStringType::kNormal).ToLocalChecked(), FunctionTemplate::New(isolate, uWS_cfg)->GetFunction(isolate->GetCurrentContext()).ToLocalChecked()).ToChecked();
@@ -464,11 +613,31 @@ NODE_MODULE_INITIALIZER(Local<Object> exports, Local<Value> module, Local<Contex
 
         PerContextData *perContextData = (PerContextData *) arg;
 
+        /* Streams left going end silently, rather than calling into JS while apps close their sockets */
+        sendStreams.clear();
+
         /* Freeing apps here, it could be done earlier but not sooner */
         perContextData->apps.clear();
         perContextData->sslApps.clear();
+        perContextData->requestLimiters.clear();
+        perContextData->webSocketStats.clear();
+        perContextData->rttHistograms.clear();
+        perContextData->assetCaches.clear();
+        /* Stop driving our timers */
+        if (fastTimers) {
+            us_timer_close(fastTimers->driver);
+        }
+        /* No other thread may push KV changes or publishes to us past this point */
+        kvUnwatchAll();
+        leavePublicationQueues();
         /* Freeing the loop here means we give time for our timers to close, etc */
         uWS::Loop::get()->free();
+        delete kvWatchQueue;
+        kvWatchQueue = nullptr;
+        delete publicationQueue;
+        publicationQueue = nullptr;
+        delete fastTimers;
+        fastTimers = nullptr;
 
         /* We can safely delete this since we no longer can call uWS.free */
         delete perContextData;
@@ -0,0 +1,56 @@
+// We are run inside tests folder and the newly built binaries are in ../dist
+const uWS = require('../dist/uws.js');
+const http = require('http');
+
+const port = 9009;
+const cacheControl = 'public, max-age=60';
+
+let failures = 0;
+
+const fail = (message) => {
+  console.error('Test failed: ' + message);
+  failures++;
+};
+
+const get = (headers) => new Promise((resolve, reject) => {
+  http.get({ port, path: '/static/a.txt', headers }, (res) => {
+    res.resume();
+    res.on('end', () => resolve(res));
+  }).on('error', reject);
+});
+
+uWS.App().assets('/static', undefined, { cacheControl })
+  .setAsset('/static/a.txt', 'hello '.repeat(100))
+  .listen(port, async (token) => {
+    if (!token) {
+      console.log('Failed to listen to port', port);
+      process.exit(1);
+    }
+
+    try {
+      for (const acceptEncoding of ['identity', 'gzip']) {
+        const res = await get({ 'accept-encoding': acceptEncoding });
+        if (res.statusCode !== 200 || res.headers['cache-control'] !== cacheControl) {
+          fail(acceptEncoding + ' got ' + res.statusCode + ' with Cache-Control ' + res.headers['cache-control']);
+          continue;
+        }
+
+        // Test 1: Revalidations keep the Cache-Control of the asset
+        const revalidated = await get({ 'accept-encoding': acceptEncoding, 'if-none-match': res.headers.etag });
+        if (revalidated.statusCode !== 304 || revalidated.headers['cache-control'] !== cacheControl) {
+          fail(acceptEncoding + ' revalidation got ' + revalidated.statusCode + ' with Cache-Control ' + revalidated.headers['cache-control']);
+        } else {
+          console.log('Test passed: 304 of ' + acceptEncoding + ' carries Cache-Control');
+        }
+      }
+    } catch (e) {
+      fail('Request failed: ' + e);
+    }
+
+    if (failures) {
+      console.error('Some tests failed.');
+      process.exit(1);
+    }
+    console.log('All tests passed.');
+    process.exit(0);
+  });
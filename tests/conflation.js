@@ -0,0 +1,86 @@
+// We are run inside tests folder and the newly built binaries are in ../dist
+const uWS = require('../dist/uws.js');
+const WebSocket = require('ws');
+
+const port = 9015;
+
+// Far more than socket buffers take, so that publishes find the WebSocket backpressured
+const backlogLength = 32 * 1024 * 1024;
+
+let failures = 0;
+
+const fail = (message) => {
+  console.error('Test failed: ' + message);
+  failures++;
+};
+
+const app = uWS.App().ws('/*', {
+  maxBackpressure: 2 * backlogLength,
+  conflationWatermark: 1024,
+  open: (ws) => {
+    ws.subscribe('price');
+    ws.send(new Uint8Array(backlogLength), true);
+    for (let i = 1; i <= 100; i++) {
+      app.publish('price', 'price ' + i, false, false, true);
+    }
+  },
+  message: (ws, message) => {
+    app.publish('price', 'price 101', false, false, true);
+    app.publish('price', 'price 102', false, false, true);
+  }
+}).listen(port, (token) => {
+  if (!token) {
+    console.log('Failed to listen to port', port);
+    process.exit(1);
+  }
+
+  const client = new WebSocket(`ws://localhost:${port}`);
+  const received = [];
+
+  // Reading nothing for a while keeps the WebSocket over its conflationWatermark
+  client.on('open', () => {
+    client._socket.pause();
+    setTimeout(() => client._socket.resume(), 100);
+  });
+
+  client.on('message', (message, isBinary) => {
+    if (isBinary) {
+      return;
+    }
+    received.push(message.toString());
+
+    if (received.length === 1) {
+      // Test 1: A backpressured subscriber only gets the latest conflated publish once drained
+      if (received[0] !== 'price 100') {
+        fail('Backpressured subscriber got ' + received[0] + ' first');
+      } else {
+        console.log('Test passed: Conflated publishes keep the latest value while backpressured');
+      }
+      setTimeout(() => client.send('again'), 50);
+      return;
+    }
+    if (received.length < 3) {
+      return;
+    }
+
+    // Test 2: Without backpressure every conflated publish goes out
+    if (received.join() !== 'price 100,price 101,price 102') {
+      fail('Conflated publishes were received as ' + received.join(', '));
+    } else {
+      console.log('Test passed: Conflated publishes go out as they are without backpressure');
+    }
+
+    client.close();
+    if (failures) {
+      console.error('Some tests failed.');
+      process.exit(1);
+    }
+    console.log('All tests passed.');
+    process.exit(0);
+  });
+
+  client.on('error', (e) => {
+    fail('Client failed: ' + e);
+    process.exit(1);
+  });
+});
@@ -0,0 +1,93 @@
+// We are run inside tests folder and the newly built binaries are in ../dist
+const uWS = require('../dist/uws.js');
+const WebSocket = require('ws');
+const { Worker, isMainThread, parentPort } = require('worker_threads');
+
+const ports = [9013, 9014];
+
+const subscribe = {
+  open: (ws) => {
+    ws.subscribe('news');
+    ws.send('ready');
+  }
+};
+
+if (!isMainThread) {
+  // An app of its own, with a topic tree of its own
+  uWS.App().ws('/*', subscribe).listen(ports[1], (token) => {
+    parentPort.postMessage(!!token);
+  });
+  parentPort.on('message', () => {
+    uWS.publish('news', 'from worker');
+  });
+  return;
+}
+
+let failures = 0;
+
+const fail = (message) => {
+  console.error('Test failed: ' + message);
+  failures++;
+};
+
+uWS.App().ws('/*', subscribe).listen(ports[0], (token) => {
+  if (!token) {
+    console.log('Failed to listen to port', ports[0]);
+    process.exit(1);
+  }
+
+  const worker = new Worker(__filename);
+  worker.on('message', (listening) => {
+    if (!listening) {
+      console.log('Failed to listen to port', ports[1]);
+      process.exit(1);
+    }
+
+    // One subscriber on the app of each thread
+    const received = [[], []];
+    let ready = 0;
+    ports.forEach((port, i) => {
+      const client = new WebSocket(`ws://localhost:${port}`);
+      client.on('message', (message) => {
+        message = message.toString();
+        if (message === 'ready') {
+          if (++ready === ports.length) {
+            uWS.publish('news', 'from main');
+            worker.postMessage('publish');
+          }
+          return;
+        }
+        received[i].push(message);
+        if (received[0].length + received[1].length < 4) {
+          return;
+        }
+
+        // Test 1: Publishes of any thread reach the subscribers of every thread
+        for (let j = 0; j < ports.length; j++) {
+          if (received[j].slice().sort().join() !== 'from main,from worker') {
+            fail('Subscriber of thread ' + j + ' got ' + received[j].join(', '));
+          }
+        }
+        if (!failures) {
+          console.log('Test passed: Publishes reach the subscribers of all threads');
+        }
+
+        if (failures) {
+          console.error('Some tests failed.');
+          process.exit(1);
+        }
+        console.log('All tests passed.');
+        process.exit(0);
+      });
+      client.on('error', (e) => {
+        fail('Client failed: ' + e);
+        process.exit(1);
+      });
+    });
+  });
+});
+
+setTimeout(() => {
+  fail('Timed out waiting for publishes');
+  process.exit(1);
+}, 5000);
@@ -0,0 +1,80 @@
+// We are run inside tests folder and the newly built binaries are in ../dist
+const uWS = require('../dist/uws.js');
+const WebSocket = require('ws');
+
+const port = 9005;
+const maxCompressLength = 1024;
+
+let failures = 0;
+
+const fail = (message) => {
+  console.error('Test failed: ' + message);
+  failures++;
+};
+
+uWS.App().ws('/*', {
+  compression: uWS.SHARED_COMPRESSOR,
+  maxCompressLength,
+  message: (ws, message) => {
+    const length = Number(Buffer.from(message).toString());
+    ws.send('a'.repeat(length), false, true);
+  }
+}).listen(port, (token) => {
+  if (!token) {
+    console.log('Failed to listen to port', port);
+    process.exit(1);
+  }
+
+  const client = new WebSocket(`ws://localhost:${port}`, { perMessageDeflate: true });
+  const lengths = [maxCompressLength, 100 * 1024];
+  let bytesRead = 0;
+
+  client.on('open', () => {
+    bytesRead = client._socket.bytesRead;
+    client.send(String(lengths[0]));
+  });
+
+  client.on('message', (message) => {
+    const wireLength = client._socket.bytesRead - bytesRead;
+    bytesRead = client._socket.bytesRead;
+
+    if (message.length !== lengths[0]) {
+      fail('Got ' + message.length + ' bytes, expected ' + lengths[0]);
+    }
+
+    // Test 1: Messages up to the cap are still compressed
+    if (lengths[0] === maxCompressLength) {
+      if (wireLength >= maxCompressLength) {
+        fail('A message of ' + maxCompressLength + ' bytes took ' + wireLength + ' bytes on the wire');
+      } else {
+        console.log('Test passed: Messages up to maxCompressLength are compressed');
+      }
+    } else {
+      // Test 2: Longer ones go out as they are
+      if (wireLength < lengths[0]) {
+        fail('A message over maxCompressLength was compressed to ' + wireLength + ' bytes');
+      } else {
+        console.log('Test passed: Messages over maxCompressLength are not compressed');
+      }
+    }
+
+    lengths.shift();
+    if (lengths.length) {
+      client.send(String(lengths[0]));
+      return;
+    }
+
+    client.close();
+    if (failures) {
+      console.error('Some tests failed.');
+      process.exit(1);
+    }
+    console.log('All tests passed.');
+    process.exit(0);
+  });
+
+  client.on('error', (e) => {
+    fail('Client failed: ' + e);
+    process.exit(1);
+  });
+});
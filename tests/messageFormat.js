@@ -0,0 +1,107 @@
+// We are run inside tests folder and the newly built binaries are in ../dist
+const uWS = require('../dist/uws.js');
+const WebSocket = require('ws');
+
+const port = 9018;
+
+let failures = 0;
+
+const fail = (message) => {
+  console.error('Test failed: ' + message);
+  failures++;
+};
+
+const echoType = {
+  message: (ws, message, isBinary) => {
+    ws.send(JSON.stringify({ type: message instanceof ArrayBuffer ? 'arraybuffer' : typeof message, message: message instanceof ArrayBuffer ? null : message, isBinary }));
+  }
+};
+
+uWS.App().ws('/string', {
+  messageFormat: 'string',
+  ...echoType
+}).ws('/json', {
+  messageFormat: 'json',
+  ...echoType
+}).ws('/parseError', {
+  messageFormat: 'json',
+  ...echoType,
+  parseError: (ws, message, error) => {
+    ws.send(JSON.stringify({ type: 'parseError', message, isSyntaxError: error instanceof SyntaxError }));
+  }
+}).listen(port, (token) => {
+  if (!token) {
+    console.log('Failed to listen to port', port);
+    process.exit(1);
+  }
+
+  // Sends messages and collects the replies, or the close code
+  const exchange = (path, messages, cb) => {
+    const client = new WebSocket(`ws://localhost:${port}${path}`);
+    const replies = [];
+    client.on('open', () => {
+      for (const [message, binary] of messages) {
+        client.send(message, { binary });
+      }
+    });
+    client.on('message', (message) => {
+      replies.push(JSON.parse(message.toString()));
+      if (replies.length === messages.length) {
+        client.close();
+        cb(replies);
+      }
+    });
+    client.on('close', (code) => {
+      if (replies.length < messages.length) {
+        cb(replies, code);
+      }
+    });
+    client.on('error', (e) => {
+      fail('Client failed: ' + e);
+      process.exit(1);
+    });
+  };
+
+  // Test 1: Text messages are strings, binary ones stay ArrayBuffers
+  exchange('/string', [['héllo', false], ['binary', true]], (replies) => {
+    if (replies[0].type !== 'string' || replies[0].message !== 'héllo' || replies[1].type !== 'arraybuffer') {
+      fail('messageFormat string gave ' + JSON.stringify(replies));
+    } else {
+      console.log('Test passed: messageFormat string');
+    }
+
+    // Test 2: Text messages are parsed as JSON
+    exchange('/json', [['{"a":[1,2]}', false], ['"text"', false]], (replies) => {
+      if (replies[0].type !== 'object' || JSON.stringify(replies[0].message) !== '{"a":[1,2]}' || replies[1].message !== 'text') {
+        fail('messageFormat json gave ' + JSON.stringify(replies));
+      } else {
+        console.log('Test passed: messageFormat json');
+      }
+
+      // Test 3: Text messages that are not JSON are given to message as string, without closing
+      exchange('/json', [['{not json', false], ['[1]', false]], (replies, code) => {
+        if (code !== undefined || replies[0].type !== 'string' || replies[0].message !== '{not json' || replies[1].type !== 'object') {
+          fail('Invalid JSON gave ' + JSON.stringify(replies) + ', close code ' + code);
+        } else {
+          console.log('Test passed: Invalid JSON is given to message as string');
+        }
+
+        // Test 4: Or to parseError along with the exception
+        exchange('/parseError', [['{not json', false], ['[1]', false]], (replies, code) => {
+          if (code !== undefined || replies[0].type !== 'parseError' || replies[0].message !== '{not json' || !replies[0].isSyntaxError || replies[1].type !== 'object') {
+            fail('Invalid JSON with parseError gave ' + JSON.stringify(replies) + ', close code ' + code);
+          } else {
+            console.log('Test passed: Invalid JSON is given to parseError');
+          }
+
+          if (failures) {
+            console.error('Some tests failed.');
+            process.exit(1);
+          }
+          console.log('All tests passed.');
+          process.exit(0);
+        });
+      });
+    });
+  });
+});
@@ -0,0 +1,81 @@
+// We are run inside tests folder and the newly built binaries are in ../dist
+const uWS = require('../dist/uws.js');
+const WebSocket = require('ws');
+
+const port = 9012;
+
+let failures = 0;
+
+const fail = (message) => {
+  console.error('Test failed: ' + message);
+  failures++;
+};
+
+const app = uWS.App().ws('/*', {
+  open: (ws) => {
+    ws.subscribe('a');
+    ws.subscribe('b');
+    ws.subscribe('c');
+    ws.subscribe('wildcard/+');
+    ws.send('ready');
+  },
+  message: (ws, message) => {
+    // Test 1: Mismatched topics and messages throw
+    try {
+      app.publishBatch(['a', 'b'], ['1']);
+      fail('publishBatch of 2 topics and 1 message did not throw');
+    } catch (e) {
+      console.log('Test passed: publishBatch of mismatched arrays throws');
+    }
+
+    // Test 2: Returns the number of publishes reaching anyone
+    const published = app.publishBatch(['a', 'nobody', 'b', 'wildcard/1', 'c'], ['1', 'never', '2', '3', '4']);
+    const publishedOne = app.publishBatch(['c', 'a'], 'same');
+    if (published !== 4 || publishedOne !== 2) {
+      fail('publishBatch returned ' + published + ' and ' + publishedOne + ', expected 4 and 2');
+    } else {
+      console.log('Test passed: publishBatch returns the number of successful publishes');
+    }
+  }
+}).listen(port, (token) => {
+  if (!token) {
+    console.log('Failed to listen to port', port);
+    process.exit(1);
+  }
+
+  const client = new WebSocket(`ws://localhost:${port}`);
+  const received = [];
+
+  client.on('message', (message) => {
+    message = message.toString();
+    if (message === 'ready') {
+      client.send('go');
+      return;
+    }
+    received.push(message);
+    if (received.length < 6) {
+      return;
+    }
+
+    // Test 3: Subscribers get the messages of their topics in the order of the batch
+    const expected = ['1', '2', '3', '4', 'same', 'same'];
+    if (received.join() !== expected.join()) {
+      fail('Batched publishes were received as ' + received.join(', '));
+    } else {
+      console.log('Test passed: Batched publishes keep their order');
+    }
+
+    client.close();
+    if (failures) {
+      console.error('Some tests failed.');
+      process.exit(1);
+    }
+    console.log('All tests passed.');
+    process.exit(0);
+  });
+
+  client.on('error', (e) => {
+    fail('Client failed: ' + e);
+    process.exit(1);
+  });
+});
@@ -0,0 +1,98 @@
+// We are run inside tests folder and the newly built binaries are in ../dist
+const uWS = require('../dist/uws.js');
+const WebSocket = require('ws');
+
+const port = 9011;
+
+let failures = 0;
+
+const fail = (message) => {
+  console.error('Test failed: ' + message);
+  failures++;
+};
+
+const counts = { messages: [0, 0], bytes: [0, 0] };
+
+const count = (name) => ({
+  message: (ws) => {
+    counts[name][0]++;
+  },
+  rateLimited: (ws) => {
+    counts[name][1]++;
+  }
+});
+
+uWS.App().ws('/messages', {
+  maxMessagesPerSecond: 10,
+  ...count('messages')
+}).ws('/bytes', {
+  maxBytesPerSecond: 1000,
+  ...count('bytes')
+}).ws('/close', {
+  maxMessagesPerSecond: 1,
+  closeOnRateLimit: true
+}).listen(port, (token) => {
+  if (!token) {
+    console.log('Failed to listen to port', port);
+    process.exit(1);
+  }
+
+  // Sends messages all at once, then reports what the server let through
+  const flood = (path, messages, cb) => {
+    const client = new WebSocket(`ws://localhost:${port}${path}`);
+    client.on('open', () => {
+      for (const message of messages) {
+        client.send(message);
+      }
+      setTimeout(() => {
+        client.close();
+        cb();
+      }, 100);
+    });
+    client.on('error', (e) => {
+      fail('Client failed: ' + e);
+      process.exit(1);
+    });
+  };
+
+  // Test 1: Messages over maxMessagesPerSecond go to rateLimited instead of message
+  flood('/messages', new Array(50).fill('a'), () => {
+    const [passed, limited] = counts.messages;
+    if (passed < 10 || passed > 11 || passed + limited !== 50) {
+      fail('maxMessagesPerSecond of 10 let ' + passed + ' of 50 through, ' + limited + ' were rate limited');
+    } else {
+      console.log('Test passed: maxMessagesPerSecond limits messages');
+    }
+
+    // Test 2: A message may go over what is left of maxBytesPerSecond, but blocks the next ones
+    flood('/bytes', new Array(10).fill('a'.repeat(300)), () => {
+      const [passed, limited] = counts.bytes;
+      if (passed !== 4 || limited !== 6) {
+        fail('maxBytesPerSecond of 1000 let ' + passed + ' of 10 messages of 300 bytes through, ' + limited + ' were rate limited');
+      } else {
+        console.log('Test passed: maxBytesPerSecond limits bytes');
+      }
+
+      // Test 3: closeOnRateLimit closes with 1008
+      const client = new WebSocket(`ws://localhost:${port}/close`);
+      client.on('open', () => {
+        client.send('a');
+        client.send('b');
+      });
+      client.on('close', (code) => {
+        if (code !== 1008) {
+          fail('closeOnRateLimit closed with ' + code);
+        } else {
+          console.log('Test passed: closeOnRateLimit closes with 1008');
+        }
+
+        if (failures) {
+          console.error('Some tests failed.');
+          process.exit(1);
+        }
+        console.log('All tests passed.');
+        process.exit(0);
+      });
+    });
+  });
+});
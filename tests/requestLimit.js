@@ -0,0 +1,149 @@
+// We are run inside tests folder and the newly built binaries are in ../dist
+const uWS = require('../dist/uws.js');
+const http = require('http');
+const WebSocket = require('ws');
+
+const port = 9003;
+const declarativePort = 9022;
+const wsPort = 9023;
+const maxRequestsPerSecond = 6;
+
+let failures = 0;
+
+const fail = (message) => {
+  console.error('Test failed: ' + message);
+  failures++;
+};
+
+// Every request passes through two yielding routes before it is answered
+const app = uWS.App({ maxRequestsPerSecond }).get('/*', (res, req) => {
+  req.setYield(true);
+}).any('/*', (res, req) => {
+  req.setYield(true);
+}).get('/*', (res, req) => {
+  res.end('ok');
+}).listen(port, (token) => {
+  if (!token) {
+    console.log('Failed to listen to port', port);
+    process.exit(1);
+  }
+
+  // Keep alive, so that consecutive requests share the socket
+  const agent = new http.Agent({ keepAlive: true, maxSockets: 1 });
+  const statuses = [];
+
+  const next = () => {
+    http.get({ port, path: '/', agent }, (response) => {
+      response.resume();
+      response.on('end', () => {
+        statuses.push(response.statusCode);
+        if (statuses.length < maxRequestsPerSecond + 4) {
+          next();
+          return;
+        }
+
+        // Test 1: Yielded requests count once, so all within the limit pass. The sliding window
+        // may let one more through when the requests straddle a second
+        const passed = statuses.filter((status) => status === 200).length;
+        if (passed < maxRequestsPerSecond || passed > maxRequestsPerSecond + 1) {
+          fail(passed + ' requests passed the limit of ' + maxRequestsPerSecond + ', statuses ' + statuses.join(', '));
+        } else {
+          console.log('Test passed: Yielded requests count once');
+        }
+
+        // Test 2: The rest is rejected
+        if (statuses[statuses.length - 1] !== 429) {
+          fail('Requests over the limit were not rejected');
+        } else {
+          console.log('Test passed: Requests over the limit are rejected');
+        }
+
+        testDeclarative();
+      });
+    }).on('error', (e) => {
+      fail('Request failed: ' + e);
+      process.exit(1);
+    });
+  };
+  next();
+});
+
+// Test 3: Declarative get routes are limited too
+const testDeclarative = () => {
+  uWS.App({ maxRequestsPerSecond }).get('/*', new uWS.DeclarativeResponse().end('ok')).listen(declarativePort, (token) => {
+    if (!token) {
+      console.log('Failed to listen to port', declarativePort);
+      process.exit(1);
+    }
+
+    const agent = new http.Agent({ keepAlive: true, maxSockets: 1 });
+    const statuses = [];
+
+    const next = () => {
+      http.get({ port: declarativePort, path: '/', agent }, (response) => {
+        response.resume();
+        response.on('end', () => {
+          statuses.push(response.statusCode);
+          if (statuses.length < maxRequestsPerSecond + 4) {
+            next();
+            return;
+          }
+
+          if (statuses[0] !== 200 || statuses[statuses.length - 1] !== 429) {
+            fail('Declarative responses were not limited, statuses ' + statuses.join(', '));
+          } else {
+            console.log('Test passed: Declarative responses are limited');
+          }
+
+          testUpgrade();
+        });
+      }).on('error', (e) => {
+        fail('Request failed: ' + e);
+        process.exit(1);
+      });
+    };
+    next();
+  });
+};
+
+// Test 4: WebSocket routes without an upgrade handler are limited too
+const testUpgrade = () => {
+  uWS.App({ maxRequestsPerSecond }).ws('/*', {
+    open: (ws) => ws.end()
+  }).listen(wsPort, (token) => {
+    if (!token) {
+      console.log('Failed to listen to port', wsPort);
+      process.exit(1);
+    }
+
+    const statuses = [];
+
+    const next = () => {
+      const client = new WebSocket(`ws://localhost:${wsPort}`);
+      const done = (status) => {
+        statuses.push(status);
+        if (statuses.length < maxRequestsPerSecond + 4) {
+          next();
+          return;
+        }
+
+        if (statuses[0] !== 101 || statuses[statuses.length - 1] !== 429) {
+          fail('Upgrades without an upgrade handler were not limited, statuses ' + statuses.join(', '));
+        } else {
+          console.log('Test passed: Upgrades without an upgrade handler are limited');
+        }
+
+        if (failures) {
+          console.error('Some tests failed.');
+          process.exit(1);
+        }
+        console.log('All tests passed.');
+        process.exit(0);
+      };
+      client.on('upgrade', () => done(101));
+      client.on('unexpected-response', (request, response) => done(response.statusCode));
+      client.on('error', () => {});
+    };
+    next();
+  });
+};
@@ -0,0 +1,79 @@
+// We are run inside tests folder and the newly built binaries are in ../dist
+const uWS = require('../dist/uws.js');
+const WebSocket = require('ws');
+
+const port = 9008;
+
+let failures = 0;
+
+const fail = (message) => {
+  console.error('Test failed: ' + message);
+  failures++;
+};
+
+const app = uWS.App().ws('/*', {
+  measureRtt: true,
+  sendPingsAutomatically: false,
+  message: (ws, message) => {
+    const stats = app.rttStats();
+    ws.send(JSON.stringify({ count: stats ? stats.count : 0, max: stats ? stats.max : 0, rtt: ws.getRtt() }));
+  }
+}).listen(port, (token) => {
+  if (!token) {
+    console.log('Failed to listen to port', port);
+    process.exit(1);
+  }
+
+  const client = new WebSocket(`ws://localhost:${port}`);
+  let pings = 0;
+
+  // The probe sent on open is answered right away by ws
+  client.on('ping', (probe) => {
+    if (++pings > 1) {
+      return;
+    }
+
+    setTimeout(() => {
+      // A made up probe from long ago, the answered probe again, and a flood of empty pongs
+      const forged = Buffer.alloc(12);
+      forged.write('rtt:');
+      client.pong(forged);
+      client.pong(probe);
+      for (let i = 0; i < 20; i++) {
+        client.pong();
+      }
+      setTimeout(() => client.send('stats'), 200);
+    }, 100);
+  });
+
+  client.on('message', (message) => {
+    const { count, max, rtt } = JSON.parse(message.toString());
+
+    // Test 1: Only the pong answering the outstanding probe is a sample
+    if (count !== 1 || max > 100 || rtt > 100) {
+      fail('Forged or replayed pongs were sampled, count ' + count + ', max ' + max + 'ms, rtt ' + rtt + 'ms');
+    } else {
+      console.log('Test passed: Forged and replayed pongs are ignored');
+    }
+
+    // Test 2: Empty pongs do not make the server probe again within the probe interval
+    if (pings !== 1) {
+      fail('Empty pongs triggered ' + (pings - 1) + ' more probes');
+    } else {
+      console.log('Test passed: Empty pongs do not flood probes');
+    }
+
+    client.close();
+    if (failures) {
+      console.error('Some tests failed.');
+      process.exit(1);
+    }
+    console.log('All tests passed.');
+    process.exit(0);
+  });
+
+  client.on('error', (e) => {
+    fail('Client failed: ' + e);
+    process.exit(1);
+  });
+});
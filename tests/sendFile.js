@@ -0,0 +1,54 @@
+// We are run inside tests folder and the newly built binaries are in ../dist
+const uWS = require('../dist/uws.js');
+const http = require('http');
+
+const port = 9010;
+const file = __filename;
+const fileSize = require('fs').statSync(file).size;
+
+let failures = 0;
+
+const fail = (message) => {
+  console.error('Test failed: ' + message);
+  failures++;
+};
+
+// Test 1: Ranges outside of the file throw instead of wrapping, a range inside is sent
+const ranges = [[-1, 10], [0, -1], [0, 10, -1], ['0', 10], [0, fileSize + 1], [fileSize, 1], [fileSize - 10, 10]];
+
+uWS.App().get('/:range', (res, req) => {
+  const range = ranges[Number(req.getParameter(0))];
+  try {
+    res.sendFile(file, ...range);
+  } catch (e) {
+    res.writeStatus('416 Range Not Satisfiable').end(e.message);
+  }
+}).listen(port, async (token) => {
+  if (!token) {
+    console.log('Failed to listen to port', port);
+    process.exit(1);
+  }
+
+  for (let i = 0; i < ranges.length; i++) {
+    const statusCode = await new Promise((resolve) => {
+      http.get({ port, path: '/' + i }, (res) => {
+        res.resume();
+        res.on('end', () => resolve(res.statusCode));
+      }).on('error', () => resolve(0));
+    });
+
+    const expected = i === ranges.length - 1 ? 200 : 416;
+    if (statusCode !== expected) {
+      fail('sendFile of ' + JSON.stringify(ranges[i]) + ' got ' + statusCode + ', expected ' + expected);
+    } else {
+      console.log('Test passed: sendFile of ' + JSON.stringify(ranges[i]) + (expected === 200 ? ' is sent' : ' throws'));
+    }
+  }
+
+  if (failures) {
+    console.error('Some tests failed.');
+    process.exit(1);
+  }
+  console.log('All tests passed.');
+  process.exit(0);
+});
@@ -0,0 +1,85 @@
+// We are run inside tests folder and the newly built binaries are in ../dist
+const uWS = require('../dist/uws.js');
+const WebSocket = require('ws');
+
+const port = 9016;
+
+// Far more than socket buffers take, so that it stays buffered
+const backlogLength = 32 * 1024 * 1024;
+
+let failures = 0;
+
+const fail = (message) => {
+  console.error('Test failed: ' + message);
+  failures++;
+};
+
+uWS.App().ws('/*', {
+  maxBackpressure: 1024,
+  message: (ws, message) => {
+    if (Buffer.from(message).toString() === 'done') {
+      ws.send('end');
+      return;
+    }
+
+    // Test 1: Messages all go out, in order, as one successful send
+    const sent = ws.sendMany(['1', '2', '3']);
+    if (sent !== 1) {
+      fail('sendMany without backpressure returned ' + sent);
+    } else {
+      console.log('Test passed: sendMany returns success');
+    }
+
+    // Test 2: Stops at the first message dropped, returning dropped
+    const dropped = ws.sendMany([new Uint8Array(backlogLength), 'dropped', 'dropped too'], true);
+    if (dropped !== 2) {
+      fail('sendMany over maxBackpressure returned ' + dropped);
+    } else {
+      console.log('Test passed: sendMany returns dropped');
+    }
+  }
+}).listen(port, (token) => {
+  if (!token) {
+    console.log('Failed to listen to port', port);
+    process.exit(1);
+  }
+
+  const client = new WebSocket(`ws://localhost:${port}`);
+  const received = [];
+
+  client.on('open', () => {
+    client.send('go');
+  });
+
+  client.on('message', (message, isBinary) => {
+    received.push(isBinary ? message.length : message.toString());
+    if (isBinary) {
+      client.send('done');
+      return;
+    }
+    if (received[received.length - 1] !== 'end') {
+      return;
+    }
+
+    // Test 3: Nothing after the dropped message went out
+    const expected = ['1', '2', '3', backlogLength, 'end'];
+    if (received.join() !== expected.join()) {
+      fail('sendMany messages were received as ' + received.join(', '));
+    } else {
+      console.log('Test passed: sendMany messages are received in order');
+    }
+
+    client.close();
+    if (failures) {
+      console.error('Some tests failed.');
+      process.exit(1);
+    }
+    console.log('All tests passed.');
+    process.exit(0);
+  });
+
+  client.on('error', (e) => {
+    fail('Client failed: ' + e);
+    process.exit(1);
+  });
+});
@@ -0,0 +1,105 @@
+// We are run inside tests folder and the newly built binaries are in ../dist
+const uWS = require('../dist/uws.js');
+const WebSocket = require('ws');
+
+const port = 9006;
+
+// Far more than socket buffers take, so that the stream spans many drains
+const streamLength = 32 * 1024 * 1024;
+
+let failures = 0;
+
+const fail = (message) => {
+  console.error('Test failed: ' + message);
+  failures++;
+};
+
+let completed = false;
+
+const app = uWS.App().ws('/*', {
+  maxBackpressure: 1024 * 1024,
+  open: (ws) => {
+    ws.subscribe('exact');
+    ws.subscribe('wildcard/+');
+    ws.subscribe('conflated');
+
+    ws.sendStream(new Uint8Array(streamLength), { fragmentSize: 16 * 1024 }, (ok) => {
+      completed = ok;
+    });
+
+    // Test 1: Nothing else goes out between the fragments
+    if (ws.sendFragment('fragment') !== 2) {
+      fail('sendFragment was not dropped while streaming');
+    }
+    ws.send('send');
+    ws.sendMany(['many 1', 'many 2']);
+    uWS.sendTo([ws], 'sendTo');
+    app.publish('exact', 'exact');
+    app.publish('wildcard/a', 'wildcard');
+    app.publish('conflated', 'conflated 1', false, false, true);
+    app.publish('conflated', 'conflated 2', false, false, true);
+
+    // Also across iterations of the loop, when the topic tree drains
+    let ticks = 0;
+    const interval = setInterval(() => {
+      if (ws.isSubscribed('exact') !== true || !ws.getTopics().includes('exact')) {
+        fail('Topics were not listed while streaming');
+      }
+      app.publish('exact', 'tick ' + ticks);
+      if (++ticks === 5) {
+        clearInterval(interval);
+      }
+    }, 5);
+  }
+}).listen(port, (token) => {
+  if (!token) {
+    console.log('Failed to listen to port', port);
+    process.exit(1);
+  }
+
+  const client = new WebSocket(`ws://localhost:${port}`);
+  const received = [];
+
+  // Reading nothing for a while builds up backpressure
+  client.on('open', () => {
+    client._socket.pause();
+    setTimeout(() => client._socket.resume(), 100);
+  });
+
+  client.on('message', (message, isBinary) => {
+    received.push(isBinary ? message.length : message.toString());
+
+    const expected = [streamLength, 'send', 'many 1', 'many 2', 'sendTo', 'exact', 'wildcard',
+      'tick 0', 'tick 1', 'tick 2', 'tick 3', 'tick 4', 'conflated 2'];
+    if (received.length < expected.length) {
+      return;
+    }
+
+    if (received.join() !== expected.join()) {
+      fail('Messages were not sent after the stream in order, got ' + received.join(', '));
+    } else {
+      console.log('Test passed: Sends and publishes wait for the stream');
+    }
+
+    // Test 2: The stream completed after what was queued went out
+    if (!completed) {
+      fail('Stream did not complete');
+    } else {
+      console.log('Test passed: Streams complete');
+    }
+
+    client.close();
+    if (failures) {
+      console.error('Some tests failed.');
+      process.exit(1);
+    }
+    console.log('All tests passed.');
+    process.exit(0);
+  });
+
+  // A data frame between fragments is a protocol error here
+  client.on('error', (e) => {
+    fail('Client failed: ' + e);
+    process.exit(1);
+  });
+});
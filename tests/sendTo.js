@@ -0,0 +1,92 @@
+// We are run inside tests folder and the newly built binaries are in ../dist
+const uWS = require('../dist/uws.js');
+const WebSocket = require('ws');
+
+const port = 9017;
+
+let failures = 0;
+
+const fail = (message) => {
+  console.error('Test failed: ' + message);
+  failures++;
+};
+
+const open = [];
+let closed = null;
+
+const broadcast = () => {
+  // Test 1: Closed WebSockets count as dropped, the others get the message
+  const statuses = uWS.sendTo([open[0], closed, open[1]], 'hello');
+  if (!(statuses instanceof Uint8Array) || Array.from(statuses).join() !== '1,2,1') {
+    fail('sendTo returned ' + statuses);
+  } else {
+    console.log('Test passed: sendTo returns the status of every WebSocket');
+  }
+
+  // Test 2: Anything but WebSockets throws
+  try {
+    uWS.sendTo([{}, open[0]], 'never');
+    fail('sendTo of a plain object did not throw');
+  } catch (e) {
+    console.log('Test passed: sendTo of a plain object throws');
+  }
+};
+
+uWS.App().ws('/*', {
+  open: (ws) => {
+    open.push(ws);
+    if (open.length === 1) {
+      ws.end();
+    }
+  },
+  close: (ws) => {
+    closed = ws;
+    open.splice(open.indexOf(ws), 1);
+  },
+  message: () => {
+    if (open.length === 2 && closed) {
+      broadcast();
+    }
+  }
+}).listen(port, (token) => {
+  if (!token) {
+    console.log('Failed to listen to port', port);
+    process.exit(1);
+  }
+
+  const received = [];
+  const connect = () => {
+    const client = new WebSocket(`ws://localhost:${port}`);
+    client.on('open', () => client.send('ready'));
+    client.on('message', (message) => {
+      received.push(message.toString());
+      if (received.length < 2) {
+        return;
+      }
+
+      if (received.join() !== 'hello,hello') {
+        fail('Recipients got ' + received.join(', '));
+      } else {
+        console.log('Test passed: Every open recipient gets the message');
+      }
+
+      if (failures) {
+        console.error('Some tests failed.');
+        process.exit(1);
+      }
+      console.log('All tests passed.');
+      process.exit(0);
+    });
+    client.on('error', (e) => {
+      fail('Client failed: ' + e);
+      process.exit(1);
+    });
+    return client;
+  };
+
+  // The first WebSocket is ended by the server before the others connect
+  connect().on('close', () => {
+    connect();
+    connect();
+  });
+});
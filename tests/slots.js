@@ -0,0 +1,111 @@
+// We are run inside tests folder and the newly built binaries are in ../dist
+// Run with --expose-gc so that idle WebSocket objects can be collected in between
+const uWS = require('../dist/uws.js');
+const WebSocket = require('ws');
+
+const port = 9007;
+
+let failures = 0;
+
+const fail = (message) => {
+  console.error('Test failed: ' + message);
+  failures++;
+};
+
+// Test 1: Schemas past the size limit, with negative or non integer capacities throw instead of wrapping or truncating
+for (const slots of [[65536], ['float64', 65532], [4294967295], [-1], [2 ** 32 + 8], [1.5], [NaN]]) {
+  try {
+    uWS.App().ws('/*', { slots });
+    fail('slots ' + JSON.stringify(slots) + ' did not throw');
+  } catch (e) {
+    console.log('Test passed: slots ' + JSON.stringify(slots) + ' throw');
+  }
+}
+
+try {
+  uWS.App().ws('/*', { weakObjects: true });
+  fail('weakObjects without slots did not throw');
+} catch (e) {
+  console.log('Test passed: weakObjects without slots throws');
+}
+
+const open = (ws) => {
+  ws.setSlot(0, 42).setSlot(1, 0.5).setSlot(2, 'abcdefghij');
+  ws.property = true;
+};
+
+const checkSlots = (ws) => {
+  if (ws.getSlot(0) !== 42 || ws.getSlot(1) !== 0.5 || Buffer.from(ws.getSlot(2)).toString() !== 'abcdefgh') {
+    fail('Slots were lost, got ' + ws.getSlot(0) + ', ' + ws.getSlot(1) + ', ' + Buffer.from(ws.getSlot(2)).toString());
+    return false;
+  }
+  return true;
+};
+
+uWS.App().ws('/strong', {
+  slots: ['int32', 'float64', 8],
+  upgrade: (res, req, context) => {
+    res.upgrade({ name: 'strong' }, req.getHeader('sec-websocket-key'), req.getHeader('sec-websocket-protocol'),
+      req.getHeader('sec-websocket-extensions'), context);
+  },
+  open,
+  message: (ws, message) => {
+    // Test 2: Without weakObjects, the JS object and the upgrade userData outlive garbage collection
+    if (checkSlots(ws)) {
+      console.log('Test passed: Slots keep their values');
+    }
+    if (!ws.property || ws.getUserData().name !== 'strong') {
+      fail('The WebSocket object lost its properties without weakObjects');
+    } else {
+      console.log('Test passed: WebSocket objects with slots are held strongly by default');
+    }
+    ws.end();
+  }
+}).ws('/weak', {
+  slots: ['int32', 'float64', 8],
+  weakObjects: true,
+  open,
+  message: (ws, message) => {
+    // Test 3: With weakObjects, slots outlive the JS object of an idle WebSocket
+    if (checkSlots(ws)) {
+      console.log('Test passed: Slots keep their values with weakObjects');
+    }
+    if (global.gc && ws.property) {
+      console.log('Note: The WebSocket object was not collected while idle');
+    }
+    ws.end();
+  }
+}).listen(port, (token) => {
+  if (!token) {
+    console.log('Failed to listen to port', port);
+    process.exit(1);
+  }
+
+  const connect = (path, done) => {
+    const client = new WebSocket(`ws://localhost:${port}${path}`);
+    client.on('open', () => {
+      setTimeout(() => {
+        if (global.gc) {
+          global.gc();
+        }
+        client.send('check');
+      }, 50);
+    });
+
+    client.on('close', done);
+
+    client.on('error', (e) => {
+      fail('Client failed: ' + e);
+      process.exit(1);
+    });
+  };
+
+  connect('/strong', () => connect('/weak', () => {
+    if (failures) {
+      console.error('Some tests failed.');
+      process.exit(1);
+    }
+    console.log('All tests passed.');
+    process.exit(0);
+  }));
+});
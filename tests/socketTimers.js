@@ -0,0 +1,130 @@
+// We are run inside tests folder and the newly built binaries are in ../dist
+const uWS = require('../dist/uws.js');
+const WebSocket = require('ws');
+const http = require('http');
+
+const port = 9002;
+
+let failures = 0;
+
+const fail = (message) => {
+  console.error('Test failed: ' + message);
+  failures++;
+};
+
+let firedAfterAbort = false;
+let firedAfterClose = false;
+let staleTimer = -1;
+
+const app = uWS.App().get('/withoutOnAborted', (res, req) => {
+  // Nothing would clear the timer if the client went away
+  try {
+    res.setTimer(10, () => {});
+    fail('res.setTimer without onAborted did not throw');
+  } catch (e) {
+    console.log('Test passed: res.setTimer without onAborted throws');
+  }
+  res.end('done');
+}).get('/delayed', (res, req) => {
+  res.onAborted(() => fail('Delayed response was aborted'));
+  try {
+    res.setTimer(Symbol('ms'), () => {});
+    fail('res.setTimer with a Symbol as ms did not throw');
+  } catch (e) {
+    console.log('Test passed: res.setTimer with invalid ms throws');
+  }
+  res.setTimer(20, (res) => {
+    res.cork(() => {
+      res.end('delayed');
+    });
+  });
+}).get('/aborted', (res, req) => {
+  res.onAborted(() => {});
+  res.setTimer(200, () => {
+    firedAfterAbort = true;
+  });
+}).get('/stale', (res, req) => {
+  res.onAborted(() => {});
+  // Fires, then is cleared late after its slot may have been reused by the next timer
+  staleTimer = res.setTimer(10, (res) => {
+    const next = res.setTimer(20, (res) => {
+      res.cork(() => {
+        res.end('stale');
+      });
+    });
+    uWS.clearTimeout(staleTimer);
+    if (next === staleTimer) {
+      fail('A socket timer handle was handed out twice');
+    }
+  });
+}).ws('/*', {
+  open: (ws) => {
+    try {
+      ws.setTimer(Symbol('ms'), () => {});
+      fail('ws.setTimer with a Symbol as ms did not throw');
+    } catch (e) {
+      console.log('Test passed: ws.setTimer with invalid ms throws');
+    }
+    ws.setTimer(200, () => {
+      firedAfterClose = true;
+    });
+  }
+}).listen(port, (token) => {
+  if (!token) {
+    console.log('Failed to listen to port', port);
+    process.exit(1);
+  }
+
+  const get = (path, cb) => {
+    http.get({ port, path }, (response) => {
+      let body = '';
+      response.on('data', (chunk) => body += chunk);
+      response.on('end', () => cb(body));
+    }).on('error', () => cb(null));
+  };
+
+  get('/withoutOnAborted', () => {
+    get('/delayed', (body) => {
+      if (body !== 'delayed') {
+        fail('res.setTimer did not fire, got ' + body);
+      } else {
+        console.log('Test passed: res.setTimer fires');
+      }
+
+      get('/stale', (body) => {
+        if (body !== 'stale') {
+          fail('A late clearTimeout cancelled the next socket timer, got ' + body);
+        } else {
+          console.log('Test passed: Late clears of socket timers are ignored');
+        }
+
+        // Timers of aborted responses and closed WebSockets are cleared
+        const request = http.get({ port, path: '/aborted' }).on('error', () => {});
+        setTimeout(() => request.destroy(), 50);
+
+        const client = new WebSocket(`ws://localhost:${port}`);
+        client.on('open', () => setTimeout(() => client.terminate(), 50));
+
+        setTimeout(() => {
+          if (firedAfterAbort) {
+            fail('res.setTimer fired after abort');
+          } else {
+            console.log('Test passed: res.setTimer is cleared on abort');
+          }
+          if (firedAfterClose) {
+            fail('ws.setTimer fired after close');
+          } else {
+            console.log('Test passed: ws.setTimer is cleared on close');
+          }
+
+          if (failures) {
+            console.error('Some tests failed.');
+            process.exit(1);
+          }
+          console.log('All tests passed.');
+          process.exit(0);
+        }, 500);
+      });
+    });
+  });
+});
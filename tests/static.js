@@ -0,0 +1,79 @@
+// We are run inside tests folder and the newly built binaries are in ../dist
+const uWS = require('../dist/uws.js');
+const http = require('http');
+const fs = require('fs');
+
+const port = 9021;
+const file = fs.readFileSync(__filename);
+const path = '/files/static.js';
+
+let failures = 0;
+
+const fail = (message) => {
+  console.error('Test failed: ' + message);
+  failures++;
+};
+
+const get = (url, headers) => new Promise((resolve, reject) => {
+  http.get({ port, path: url, headers }, (res) => {
+    const chunks = [];
+    res.on('data', (chunk) => chunks.push(chunk));
+    res.on('end', () => resolve([res, Buffer.concat(chunks)]));
+  }).on('error', reject);
+});
+
+uWS.App().static('/files', __dirname).listen(port, async (token) => {
+  if (!token) {
+    console.log('Failed to listen to port', port);
+    process.exit(1);
+  }
+
+  try {
+    // Test 1: Files are served whole, with validators
+    const [res, body] = await get(path);
+    if (res.statusCode !== 200 || !body.equals(file) || !res.headers.etag || !res.headers['last-modified']) {
+      fail('GET gave ' + res.statusCode + ' with ' + body.length + ' of ' + file.length + ' bytes');
+    } else {
+      console.log('Test passed: Files are served');
+    }
+
+    // Test 2: Conditional requests are answered with 304
+    const [notModified] = await get(path, { 'if-none-match': res.headers.etag });
+    const [notModifiedSince] = await get(path, { 'if-modified-since': res.headers['last-modified'] });
+    if (notModified.statusCode !== 304 || notModifiedSince.statusCode !== 304) {
+      fail('Conditional requests gave ' + notModified.statusCode + ' and ' + notModifiedSince.statusCode);
+    } else {
+      console.log('Test passed: Conditional requests');
+    }
+
+    // Test 3: Byte ranges are served with 206, unsatisfiable ones with 416
+    const [partial, partialBody] = await get(path, { range: 'bytes=10-19' });
+    const [suffix, suffixBody] = await get(path, { range: 'bytes=-5' });
+    const [unsatisfiable] = await get(path, { range: 'bytes=' + file.length + '-' });
+    if (partial.statusCode !== 206 || !partialBody.equals(file.subarray(10, 20)) || partial.headers['content-range'] !== 'bytes 10-19/' + file.length ||
+        suffix.statusCode !== 206 || !suffixBody.equals(file.subarray(file.length - 5)) || unsatisfiable.statusCode !== 416) {
+      fail('Ranges gave ' + partial.statusCode + ' ' + partial.headers['content-range'] + ', ' + suffix.statusCode + ' and ' + unsatisfiable.statusCode);
+    } else {
+      console.log('Test passed: Range requests');
+    }
+
+    // Test 4: Nothing outside of the directory, and nothing missing
+    for (const url of ['/files/../package.json', '/files/%2e%2e/package.json', '/files/missing.js']) {
+      const [outside] = await get(url);
+      if (outside.statusCode !== 404) {
+        fail(url + ' gave ' + outside.statusCode);
+      } else {
+        console.log('Test passed: ' + url + ' is not found');
+      }
+    }
+  } catch (e) {
+    fail('Request failed: ' + e);
+  }
+
+  if (failures) {
+    console.error('Some tests failed.');
+    process.exit(1);
+  }
+  console.log('All tests passed.');
+  process.exit(0);
+});
@@ -0,0 +1,278 @@
+// We are run inside tests folder and the newly built binaries are in ../dist
+const uWS = require('../dist/uws.js');
+const { Worker, isMainThread, parentPort } = require('worker_threads');
+
+if (!isMainThread) {
+  // Timers of a worker run on the wheel of its own loop
+  const start = Date.now();
+  uWS.setTimeout(() => parentPort.postMessage(Date.now() - start), 20);
+  return;
+}
+
+let failures = 0;
+
+const fail = (message) => {
+  console.error('Test failed: ' + message);
+  failures++;
+};
+
+const now = () => Number(process.hrtime.bigint() / 1000n) / 1000;
+
+// Test 1: A timeout never fires before its ms have passed, wherever in the 10ms tick it was set
+const testNeverEarly = (done) => {
+  let pending = 0;
+  const delays = [0, 1, 5, 9, 10, 11, 15, 20, 25, 50];
+
+  const schedule = (round) => {
+    if (round === 20) {
+      return;
+    }
+    for (const ms of delays) {
+      const start = now();
+      pending++;
+      uWS.setTimeout(() => {
+        const elapsed = now() - start;
+        if (elapsed < ms) {
+          fail('setTimeout of ' + ms + 'ms fired after ' + elapsed.toFixed(3) + 'ms');
+        }
+        if (!--pending) {
+          console.log('Test passed: Timers never fire early');
+          done();
+        }
+      }, ms);
+    }
+    // Spread the rounds over different moments within the tick
+    setTimeout(() => schedule(round + 1), 3);
+  };
+  schedule(0);
+};
+
+// Test 2: Timers set from within a timer callback are counted from that callback, not from the tick
+const testNeverEarlyFromCallback = (done) => {
+  const start = now();
+  uWS.setTimeout(() => {
+    // Block past several ticks so that the wheel runs them late
+    while (now() - start < 60);
+    const setAt = now();
+    uWS.setTimeout(() => {
+      const elapsed = now() - setAt;
+      if (elapsed < 10) {
+        fail('setTimeout of 10ms set from a late callback fired after ' + elapsed.toFixed(3) + 'ms');
+      } else {
+        console.log('Test passed: Timers set from late callbacks never fire early');
+      }
+      done();
+    }, 10);
+  }, 10);
+};
+
+// Test 3: Huge timeouts do not wrap into short ones
+const testHugeTimeout = (done) => {
+  const timer = uWS.setTimeout(() => {
+    fail('setTimeout of 4294967295ms fired');
+  }, 4294967295);
+  setTimeout(() => {
+    uWS.clearTimeout(timer);
+    console.log('Test passed: Huge timeouts do not wrap');
+    done();
+  }, 100);
+};
+
+// Test 4: Clearing a stale handle does not cancel the unrelated timer now holding its slot
+const testStaleHandles = (done) => {
+  let fired = 0;
+
+  // Freed slots are handed out again right away
+  const cleared = uWS.setTimeout(() => fail('Cleared timer fired'), 20);
+  uWS.clearTimeout(cleared);
+  const reusing = uWS.setTimeout(() => {
+    fired++;
+    // Takes the slot of the timer that fired below, which is cleared late
+    uWS.setTimeout(() => {
+      fired++;
+      if (fired !== 3) {
+        fail('Timers reusing a slot were cancelled by stale handles, ' + fired + ' of 3 fired');
+      } else {
+        console.log('Test passed: Stale handles are ignored');
+      }
+      done();
+    }, 10);
+    uWS.clearTimeout(firedEarlier);
+    uWS.clearTimeout(undefined);
+    uWS.clearTimeout(Symbol('timer'));
+  }, 20);
+  uWS.clearTimeout(cleared);
+  if (reusing === cleared) {
+    fail('A handle was handed out twice');
+  }
+
+  const firedEarlier = uWS.setTimeout(() => {
+    fired++;
+  }, 10);
+};
+
+// Test 5: Timers grow past the million that used to be the fixed limit
+const testManyTimers = (done) => {
+  const count = 1100000;
+  let expired = 0;
+  uWS.onExpired((timers) => {
+    expired += timers.length;
+    if (expired === count) {
+      uWS.onExpired(null);
+      console.log('Test passed: ' + count + ' timers fire');
+      done();
+    }
+  });
+  try {
+    for (let i = 0; i < count; i++) {
+      uWS.setTimeout(null, 50);
+    }
+  } catch (e) {
+    fail('Setting ' + count + ' timers threw ' + e);
+    uWS.onExpired(null);
+    done();
+  }
+};
+
+// Test 6: Worker threads have timers of their own, firing alongside those of the main thread
+const testWorkerTimers = (done) => {
+  let mainFired = false;
+  uWS.setTimeout(() => {
+    mainFired = true;
+  }, 10);
+  new Worker(__filename).on('message', (elapsed) => {
+    if (elapsed < 20 || !mainFired) {
+      fail('Timer of a worker fired after ' + elapsed + 'ms, main thread timer fired: ' + mainFired);
+    } else {
+      console.log('Test passed: Worker threads have their own timers');
+    }
+    done();
+  }).on('error', (e) => {
+    fail('Worker failed: ' + e);
+    done();
+  });
+};
+
+// Test 7: Callbacks may clear their own timer and others expiring in the same tick
+const testClearFromCallback = (done) => {
+  let fired = 0;
+  const timers = [];
+  for (let i = 0; i < 10; i++) {
+    timers.push(uWS.setTimeout(() => {
+      fired++;
+      // Whichever fires first clears itself and all the others of the tick
+      for (const timer of timers) {
+        uWS.clearTimeout(timer);
+      }
+    }, 10));
+  }
+  setTimeout(() => {
+    if (fired !== 1) {
+      fail(fired + ' of 10 timers fired while the first one cleared the rest');
+    } else {
+      console.log('Test passed: Timers may be cleared from callbacks');
+    }
+    done();
+  }, 100);
+};
+
+// Test 8: Intervals repeat until cleared, also from within their own callback
+const testInterval = (done) => {
+  let fired = 0;
+  const interval = uWS.setInterval(() => {
+    if (++fired === 3) {
+      uWS.clearInterval(interval);
+    }
+  }, 10);
+  setTimeout(() => {
+    if (fired !== 3) {
+      fail('Interval fired ' + fired + ' times, expected 3');
+    } else {
+      console.log('Test passed: Intervals repeat until cleared');
+    }
+    done();
+  }, 150);
+};
+
+// Test 9: Timers without callback expiring in the same tick are delivered as one array
+const testBatchExpiry = (done) => {
+  const timers = new Set();
+  let calls = 0;
+  let delivered = 0;
+  uWS.onExpired((expired) => {
+    calls++;
+    for (const timer of expired) {
+      if (!timers.has(timer)) {
+        fail('Unknown timer ' + timer + ' was delivered');
+      }
+      delivered++;
+    }
+  });
+  for (let i = 0; i < 1000; i++) {
+    timers.add(uWS.setTimeout(null, 20));
+  }
+  const cleared = uWS.setTimeout(null, 20);
+  uWS.clearTimeout(cleared);
+  setTimeout(() => {
+    uWS.onExpired(null);
+    if (delivered !== 1000 || calls > 2) {
+      fail(delivered + ' of 1000 timers were delivered in ' + calls + ' calls');
+    } else {
+      console.log('Test passed: Expired timers are delivered in one call per tick');
+    }
+    done();
+  }, 100);
+};
+
+// Test 10: Intervals of 0ms repeat every tick rather than firing once
+const testZeroInterval = (done) => {
+  let fired = 0;
+  const interval = uWS.setInterval(() => {
+    if (++fired === 3) {
+      uWS.clearInterval(interval);
+    }
+  }, 0);
+  setTimeout(() => {
+    if (fired !== 3) {
+      fail('Interval of 0ms fired ' + fired + ' times, expected 3');
+    } else {
+      console.log('Test passed: Intervals of 0ms repeat');
+    }
+    done();
+  }, 150);
+};
+
+// Test 11: Anything but a number from 0 to 2^32 - 1 as ms throws instead of aborting or wrapping
+const testInvalidMs = (done) => {
+  const invalid = [Symbol('ms'), '10', undefined, -1, NaN, 2 ** 32];
+  for (const ms of invalid) {
+    for (const [name, call] of [['setTimeout', () => uWS.setTimeout(() => {}, ms)],
+      ['setInterval', () => uWS.setInterval(() => {}, ms)], ['arm', () => uWS.arm(ms)]]) {
+      try {
+        const timer = call();
+        uWS.clearTimeout(timer);
+        fail(name + ' with ' + String(ms) + ' as ms did not throw');
+      } catch (e) {
+      }
+    }
+  }
+  console.log('Test passed: Invalid ms throw');
+  done();
+};
+
+const tests = [testNeverEarly, testNeverEarlyFromCallback, testHugeTimeout, testStaleHandles, testManyTimers, testWorkerTimers,
+  testClearFromCallback, testInterval, testBatchExpiry, testZeroInterval, testInvalidMs];
+
+const next = () => {
+  const test = tests.shift();
+  if (test) {
+    test(next);
+  } else if (failures) {
+    console.error('Some tests failed.');
+    process.exit(1);
+  } else {
+    console.log('All tests passed.');
+    process.exit(0);
+  }
+};
+next();
@@ -0,0 +1,89 @@
+// We are run inside tests folder and the newly built binaries are in ../dist
+const uWS = require('../dist/uws.js');
+const WebSocket = require('ws');
+
+const port = 9019;
+
+let failures = 0;
+
+const fail = (message) => {
+  console.error('Test failed: ' + message);
+  failures++;
+};
+
+const app = uWS.App({ topicStats: true }).ws('/*', {
+  open: (ws) => {
+    ws.subscribe('a');
+    ws.subscribe('b');
+    ws.subscribe('wildcard/+');
+    ws.send('ready');
+  },
+  message: (ws) => {
+    // Test 1: topicCount counts exact and wildcard subscriptions alike
+    if (ws.topicCount() !== 3 || ws.topicCount() !== ws.getTopics().length) {
+      fail('topicCount was ' + ws.topicCount() + ' with topics ' + ws.getTopics().join(', '));
+    } else {
+      console.log('Test passed: topicCount');
+    }
+
+    // Test 2: Subscriber counts of many topics in one call, in order
+    const counts = app.numSubscribersMany(['b', 'nobody', 'a']);
+    if (!(counts instanceof Int32Array) || Array.from(counts).join() !== [app.numSubscribers('b'), 0, app.numSubscribers('a')].join() || counts[0] < 1) {
+      fail('numSubscribersMany returned ' + counts);
+    } else {
+      console.log('Test passed: numSubscribersMany');
+    }
+
+    // Test 3: Publishes and bytes by topic since the last call
+    app.topicStats(() => {});
+    app.publish('a', '12345');
+    app.publish('a', '123');
+    app.publish('nobody', '1');
+    const stats = {};
+    app.topicStats((topic, subscribers, publishes, bytes) => {
+      stats[topic] = [subscribers, publishes, bytes];
+    });
+    const again = [];
+    app.topicStats((topic) => again.push(topic));
+    if (JSON.stringify(stats) !== JSON.stringify({ a: [counts[2], 2, 8], nobody: [0, 1, 1] }) || again.length) {
+      fail('topicStats gave ' + JSON.stringify(stats) + ', then ' + again.join(', '));
+    } else {
+      console.log('Test passed: topicStats');
+    }
+    ws.end();
+  }
+}).listen(port, (token) => {
+  if (!token) {
+    console.log('Failed to listen to port', port);
+    process.exit(1);
+  }
+
+  // Test 4: topicStats requires the app option
+  try {
+    uWS.App().topicStats(() => {});
+    fail('topicStats without the app option did not throw');
+  } catch (e) {
+    console.log('Test passed: topicStats without the app option throws');
+  }
+
+  const client = new WebSocket(`ws://localhost:${port}`);
+  client.on('message', (message) => {
+    if (message.toString() === 'ready') {
+      client.send('go');
+    }
+  });
+
+  client.on('close', () => {
+    if (failures) {
+      console.error('Some tests failed.');
+      process.exit(1);
+    }
+    console.log('All tests passed.');
+    process.exit(0);
+  });
+
+  client.on('error', (e) => {
+    fail('Client failed: ' + e);
+    process.exit(1);
+  });
+});
@@ -0,0 +1,68 @@
+// We are run inside tests folder and the newly built binaries are in ../dist
+const uWS = require('../dist/uws.js');
+const { Worker, isMainThread } = require('worker_threads');
+
+if (!isMainThread) {
+  // Changes made by another thread
+  uWS.setString('user:1', 'a', 'watched');
+  uWS.setString('user:1', 'b', 'watched');
+  uWS.setString('other', 'c', 'watched');
+  uWS.setString('user:2', 'd', 'unwatched');
+  uWS.setString('user:3', 'e', 'watched');
+  uWS.deleteStringCollection('watched');
+  return;
+}
+
+let failures = 0;
+
+const fail = (message) => {
+  console.error('Test failed: ' + message);
+  failures++;
+};
+
+// Test 1: Invalid watcher ids throw instead of aborting
+try {
+  uWS.unwatch(Symbol('watcher'));
+  fail('unwatch of a Symbol did not throw');
+} catch (e) {
+  console.log('Test passed: unwatch of a Symbol throws');
+}
+uWS.unwatch(123456);
+
+// Test 2: Changes of other threads are delivered, filtered by collection and prefix, in order
+const received = [];
+const watcher = uWS.watch('watched', 'user:', (keys) => {
+  received.push(...keys);
+  if (received[received.length - 1] === null) {
+    const expected = ['user:1', 'user:3', null];
+    // Repeated keys are only coalesced within one batch
+    const deduplicated = received.filter((key, i) => key !== received[i - 1]);
+    if (JSON.stringify(deduplicated) !== JSON.stringify(expected)) {
+      fail('Received ' + JSON.stringify(received) + ', expected ' + JSON.stringify(expected));
+    } else {
+      console.log('Test passed: Changes of other threads are delivered');
+    }
+    uWS.unwatch(watcher);
+
+    // Test 3: Nothing is delivered once unwatched
+    uWS.setString('user:4', 'f', 'watched');
+    setTimeout(() => {
+      if (received.includes('user:4')) {
+        fail('Changes were delivered after unwatch');
+      }
+      if (failures) {
+        console.error('Some tests failed.');
+        process.exit(1);
+      }
+      console.log('All tests passed.');
+      process.exit(0);
+    }, 100);
+  }
+});
+
+new Worker(__filename);
+
+setTimeout(() => {
+  fail('Timed out waiting for changes');
+  process.exit(1);
+}, 5000);
@@ -0,0 +1,80 @@
+// We are run inside tests folder and the newly built binaries are in ../dist
+const uWS = require('../dist/uws.js');
+const WebSocket = require('ws');
+
+const port = 9004;
+
+let failures = 0;
+
+const fail = (message) => {
+  console.error('Test failed: ' + message);
+  failures++;
+};
+
+const app = uWS.App().ws('/*', {
+  open: (ws) => {
+    ws.subscribe('exact');
+    ws.subscribe('sensors/+/temperature');
+    ws.subscribe('logs/#');
+    ws.send('ready');
+  },
+  message: (ws, message) => {
+    // Test 1: Publishes reach wildcard subscribers, but only when a pattern matches
+    if (!app.publish('sensors/1/temperature', 'not yet')) {
+      fail('Publish to a matching wildcard subscriber returned false');
+    }
+    if (app.publish('sensors/1/humidity', 'never')) {
+      fail('Publish without any matching subscriber returned true');
+    } else {
+      console.log('Test passed: Publishes return whether they reached anyone');
+    }
+
+    // Test 2: Exact and wildcard deliveries keep the order they were published in
+    app.publish('exact', '1');
+    app.publish('sensors/2/temperature', '2');
+    app.publish('exact', '3');
+    app.publish('logs', '4');
+    app.publish('exact', '5');
+    app.publish('logs/a/b', '6');
+  }
+}).listen(port, (token) => {
+  if (!token) {
+    console.log('Failed to listen to port', port);
+    process.exit(1);
+  }
+
+  const client = new WebSocket(`ws://localhost:${port}`);
+  const received = [];
+
+  client.on('message', (message) => {
+    message = message.toString();
+    if (message === 'ready') {
+      client.send('go');
+      return;
+    }
+    received.push(message);
+    if (received.length < 7) {
+      return;
+    }
+
+    const expected = ['not yet', '1', '2', '3', '4', '5', '6'];
+    if (received.join() !== expected.join()) {
+      fail('Wildcard publishes were reordered, got ' + received.join(', '));
+    } else {
+      console.log('Test passed: Wildcard publishes keep their order');
+    }
+
+    client.close();
+    if (failures) {
+      console.error('Some tests failed.');
+      process.exit(1);
+    }
+    console.log('All tests passed.');
+    process.exit(0);
+  });
+
+  client.on('error', (e) => {
+    fail('Client failed: ' + e);
+    process.exit(1);
+  });
+});
@@ -0,0 +1,88 @@
+// We are run inside tests folder and the newly built binaries are in ../dist
+const uWS = require('../dist/uws.js');
+const WebSocket = require('ws');
+
+const port = 9020;
+
+// Far more than socket buffers take, so that what is sent after it is dropped
+const backlogLength = 32 * 1024 * 1024;
+
+let failures = 0;
+
+const fail = (message) => {
+  console.error('Test failed: ' + message);
+  failures++;
+};
+
+const app = uWS.App().ws('/drop', {
+  maxBackpressure: 1024,
+  open: (ws) => {
+    ws.send(new Uint8Array(backlogLength), true);
+    ws.send('a');
+    ws.send('bc');
+  },
+  message: (ws) => {
+    ws.send(JSON.stringify(app.wsStats('/drop')));
+  }
+}).ws('/close', {
+  maxBackpressure: 1024,
+  closeOnBackpressureLimit: true,
+  open: (ws) => {
+    ws.send(new Uint8Array(backlogLength), true);
+    ws.send('a');
+    ws.send('b');
+  }
+}).listen(port, (token) => {
+  if (!token) {
+    console.log('Failed to listen to port', port);
+    process.exit(1);
+  }
+
+  // Test 1: Behaviors that do not exist have no stats
+  if (app.wsStats('/nothing') !== undefined) {
+    fail('wsStats of an unknown pattern was not undefined');
+  } else {
+    console.log('Test passed: wsStats of an unknown pattern');
+  }
+
+  const client = new WebSocket(`ws://localhost:${port}/drop`);
+  client.on('message', (message, isBinary) => {
+    if (isBinary) {
+      client.send('stats');
+      return;
+    }
+
+    // Test 2: Drops are counted without a dropped handler, and so are drains
+    const stats = JSON.parse(message.toString());
+    if (stats.droppedMessages !== 2 || stats.droppedBytes !== 3 || stats.backpressureCloses !== 0 || stats.drains < 1 || stats.maxBufferedAmount <= 1024) {
+      fail('wsStats of drops gave ' + JSON.stringify(stats));
+    } else {
+      console.log('Test passed: Drops and drains are counted');
+    }
+    client.close();
+
+    // Test 3: Closes for going over maxBackpressure are counted once per WebSocket
+    const closing = new WebSocket(`ws://localhost:${port}/close`);
+    closing.on('close', () => {
+      const stats = app.wsStats('/close');
+      if (stats.backpressureCloses !== 1 || stats.droppedMessages < 1) {
+        fail('wsStats of backpressure closes gave ' + JSON.stringify(stats));
+      } else {
+        console.log('Test passed: Backpressure closes are counted');
+      }
+
+      if (failures) {
+        console.error('Some tests failed.');
+        process.exit(1);
+      }
+      console.log('All tests passed.');
+      process.exit(0);
+    });
+    closing.on('error', () => {});
+  });
+
+  client.on('error', (e) => {
+    fail('Client failed: ' + e);
+    process.exit(1);
+  });
+});